@@ -0,0 +1,291 @@
+#include "AlphaBetaEngine.hh"
+#include "bitboard.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+AlphaBetaEngine::AlphaBetaEngine(Board& b, bool amWhite, const size_t hash_mb) :
+    Engine(b, amWhite), tt(hash_mb), quiescence_checks(0), node_count(0), stopped(false), root_best(), iteration_best() {}
+
+PackedMove AlphaBetaEngine::get_move(PackedMove) {
+    node_count = 0;
+    stopped = false;
+    clock.begin(limits);
+    tt.new_search();
+    MoveList moves;
+    board.get_legal_moves(board.is_white_turn(), moves);
+    if (moves.empty()) {
+        return PackedMove{};
+    }
+    root_best = moves[0];
+
+    int max_depth = limits.depth ? limits.depth : limits.nodes || clock.is_timed() ? MAX_PLY - 1 : DEFAULT_DEPTH;
+    int score = 0;
+    for (int depth = 1; depth <= max_depth && depth < MAX_PLY && clock.can_start_iteration(); ++depth) {
+        int previous = score;
+        score = aspiration_search(depth, previous);
+        // A move that beat the last iteration's best before the stop is
+        // still better than it; otherwise keep the last finished result
+        if (stopped) {
+            if (!iteration_best.is_null()) {
+                root_best = iteration_best;
+            }
+            break;
+        }
+        bool best_changed = depth > 1 && iteration_best != root_best;
+        root_best = iteration_best;
+        clock.iteration_done(depth > 1 && score < previous - FAIL_LOW_MARGIN, best_changed);
+        if (on_info) {
+            on_info(Search_Info{depth, node_count, clock.elapsed_ms() / 1000, score / 100.0, root_best});
+        }
+        // Going deeper won't change a forced mate
+        if (std::abs(score) >= MATE - MAX_PLY) {
+            break;
+        }
+    }
+    return root_best;
+}
+
+// Searches a narrow window around the last iteration's score first, since
+// the score rarely moves far and a narrow window cuts off much more. If the
+// score lands outside, the window widens on that side and it searches again.
+int AlphaBetaEngine::aspiration_search(const int depth, const int previous) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INF, beta = INF;
+    if (depth >= ASPIRATION_DEPTH && std::abs(previous) < MATE - MAX_PLY) {
+        alpha = previous - delta;
+        beta = previous + delta;
+    }
+    iteration_best = PackedMove{};
+    while (true) {
+        int score = search(depth, alpha, beta, 0);
+        if (stopped) {
+            return score;
+        }
+        if (score <= alpha && alpha > -INF) {
+            // Nothing beat alpha, so there's no best move to keep. After
+            // failing high the move that did is kept in case time runs out.
+            iteration_best = PackedMove{};
+            alpha = delta > MAX_ASPIRATION ? -INF : std::max(score - delta, -INF);
+        } else if (score >= beta && beta < INF) {
+            beta = delta > MAX_ASPIRATION ? INF : std::min(score + delta, INF);
+        } else {
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+// Nodes are checked every time so a node budget gives the same search every
+// run; the clock is only read now and then
+bool AlphaBetaEngine::count_node() {
+    ++node_count;
+    if ((limits.nodes && node_count > limits.nodes) || ((node_count & 1023) == 0 && clock.must_stop())) {
+        stopped = true;
+    }
+    return !stopped;
+}
+
+int AlphaBetaEngine::search(const int depth, int alpha, const int beta, const int ply) {
+    if (depth <= 0) {
+        return quiesce(alpha, beta, ply, quiescence_checks);
+    }
+    if (!count_node()) {
+        return 0;
+    }
+    if (ply && (board.halfmove_clock() >= 100 || board.is_repetition())) {
+        return 0;
+    }
+
+    uint64_t key = board.hash();
+    TT_Entry hit;
+    PackedMove tt_move{};
+    if (tt.probe(key, hit)) {
+        tt_move = hit.move;
+        int score = score_from_tt(hit.score, ply);
+        if (ply && hit.depth >= depth &&
+            (hit.bound == BOUND_EXACT || (hit.bound == BOUND_LOWER && score >= beta) ||
+             (hit.bound == BOUND_UPPER && score <= alpha))) {
+            return score;
+        }
+    }
+
+    MoveList moves;
+    board.get_legal_moves(board.is_white_turn(), moves);
+    if (moves.empty()) {
+        return board.in_check() ? -MATE + ply : 0;
+    }
+    order_moves(moves, ply ? tt_move : root_best);
+
+    const int original_alpha = alpha;
+    int best = -INF;
+    PackedMove best_move{};
+    for (const PackedMove &m : moves) {
+        tt.prefetch(board.key_after(m));
+        UndoInfo undo = board.make_move(m);
+        int score = -search(depth - 1, -beta, -alpha, ply + 1);
+        board.unmake_move(m, undo);
+        if (stopped) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            best_move = m;
+        }
+        // At the root, only a move that beats alpha is known to be better
+        // than the ones before it, which matters when the search is cut short
+        if (!ply && score > alpha) {
+            iteration_best = m;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                break;
+            }
+        }
+    }
+    BOUND bound = best >= beta ? BOUND_LOWER : best > original_alpha ? BOUND_EXACT : BOUND_UPPER;
+    tt.store(key, best_move, score_to_tt(best, ply), depth, bound);
+    return best;
+}
+
+// Plays out the captures and promotions at the end of the main search, so
+// the score doesn't come from the middle of an exchange. The side to move
+// can stand pat on the static eval if nothing is worth taking, and captures
+// that couldn't bring the score up to alpha even if the piece came for free,
+// or that lose material by see, are skipped. Out of check nothing else is
+// searched, except quiet checks for the first $checks plies; in check every
+// evasion is.
+int AlphaBetaEngine::quiesce(int alpha, const int beta, const int ply, const int checks) {
+    if (!count_node()) {
+        return 0;
+    }
+    if (ply >= MAX_PLY - 1) {
+        return static_eval();
+    }
+    bool in_check = board.in_check();
+    MoveList moves;
+    int best = -INF;
+    int stand_pat = 0;
+    if (in_check) {
+        board.get_legal_moves(board.is_white_turn(), moves);
+        if (moves.empty()) {
+            return -MATE + ply;
+        }
+    } else {
+        stand_pat = best = static_eval();
+        if (best >= beta) {
+            return best;
+        }
+        alpha = std::max(alpha, best);
+        if (checks > 0) {
+            board.get_legal_moves(board.is_white_turn(), moves);
+        } else {
+            board.get_captures(board.is_white_turn(), moves);
+        }
+    }
+    order_moves(moves, PackedMove{});
+
+    for (const PackedMove &m : moves) {
+        bool tactical = m.is_capture() || m.is_promotion();
+        if (!in_check && tactical && !m.is_promotion()) {
+            int victim = m.flag() == PackedMove::EP_CAPTURE ? (uint)PAWN : board.piece_type(m.end());
+            if (stand_pat + PIECE_VALUES[victim] + DELTA_MARGIN <= alpha) {
+                continue;
+            }
+            // Nor is a capture that loses material once the exchange on the
+            // square is played out
+            if (PIECE_VALUES[victim] < PIECE_VALUES[board.piece_type(m.start())] && !board.see_ge(m, 0)) {
+                continue;
+            }
+        }
+        // Quiet moves are only here, out of check, for the checks among them
+        if (!in_check && !tactical && !board.gives_check(m)) {
+            continue;
+        }
+        UndoInfo undo = board.make_move(m);
+        int score = -quiesce(-beta, -alpha, ply + 1, checks - 1);
+        board.unmake_move(m, undo);
+        if (stopped) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// Mate scores count plies from the root, but a table entry can be found
+// from any ply, so they're stored counting from the position itself
+int AlphaBetaEngine::score_to_tt(const int score, const int ply) {
+    if (score >= MATE - MAX_PLY) {
+        return score + ply;
+    }
+    if (score <= -MATE + MAX_PLY) {
+        return score - ply;
+    }
+    return score;
+}
+
+int AlphaBetaEngine::score_from_tt(const int score, const int ply) {
+    if (score >= MATE - MAX_PLY) {
+        return score - ply;
+    }
+    if (score <= -MATE + MAX_PLY) {
+        return score + ply;
+    }
+    return score;
+}
+
+// Centipawns for the side to move
+int AlphaBetaEngine::static_eval() {
+    PROFILE_SCOPE(PROFILE_EVALUATE);
+    int score = pst_score(board);
+    return board.is_white_turn() ? score : -score;
+}
+
+// The given move first, then captures, most valuable victim first and the
+// cheapest attacker first among those, then promotions, then the rest in
+// generator order, except that captures losing material by see go last
+void AlphaBetaEngine::order_moves(MoveList &moves, const PackedMove first) const {
+    int keys[256];
+    for (uint i = 0; i < moves.size(); ++i) {
+        const PackedMove m = moves[i];
+        int key = 0;
+        if (m == first) {
+            key = 1000;
+        } else if (m.is_capture()) {
+            int victim = m.flag() == PackedMove::EP_CAPTURE ? (uint)PAWN : board.piece_type(m.end());
+            uint attacker = board.piece_type(m.start());
+            key = 100 + 10 * victim - attacker;
+            // Taking something worth at least the attacker can't lose material
+            if (PIECE_VALUES[victim] < PIECE_VALUES[attacker] && !board.see_ge(m, 0)) {
+                key -= 200;
+            }
+        } else if (m.is_promotion()) {
+            key = 50 + m.promotion();
+        }
+        // Insertion sort; stable, and the lists are short
+        uint j = i;
+        for (; j > 0 && keys[j - 1] < key; --j) {
+            keys[j] = keys[j - 1];
+            moves[j] = moves[j - 1];
+        }
+        keys[j] = key;
+        moves[j] = m;
+    }
+}
+
+double AlphaBetaEngine::evaluate() {
+    int score = pst_score(board);
+    return (white ? score : -score) / 100.0;
+}
+
+void AlphaBetaEngine::process_result(const bool, const bool) {}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Engine.hh"
+#include "time_manager.hh"
+#include "transposition.hh"
+
+// Negamax alpha-beta over the engine's board, making and unmaking moves in
+// place rather than copying positions. It searches one ply deeper at a time,
+// each iteration in an aspiration window around the last one's score, until
+// it reaches the depth limit or runs out of nodes or time; Time_Manager
+// budgets the time when it's playing on a clock. With no limits at all it
+// searches DEFAULT_DEPTH plies. What it learns goes in a transposition table
+// that lasts from move to move. At the horizon a quiescence search plays out
+// the captures and promotions before anything is scored.
+//
+// Scores are in centipawns for the side to move. A mate n plies from the root
+// scores MATE - n, so nearer mates score higher.
+class AlphaBetaEngine : public Engine {
+    public:
+        static constexpr int DEFAULT_DEPTH = 5;
+        static constexpr int MAX_PLY = 128;
+        static constexpr int MATE = 32000;
+        static constexpr int INF = MATE + 1;
+        static constexpr size_t DEFAULT_HASH_MB = 16;
+        // Aspiration windows start ASPIRATION_WINDOW either side of the last
+        // score from ASPIRATION_DEPTH on, doubling on each miss until they're
+        // wider than MAX_ASPIRATION and the search goes full width
+        static constexpr int ASPIRATION_DEPTH = 4;
+        static constexpr int ASPIRATION_WINDOW = 25;
+        static constexpr int MAX_ASPIRATION = 800;
+        // A score this far below the last iteration's counts as failing low
+        static constexpr int FAIL_LOW_MARGIN = 30;
+        // What a capture might win beyond the piece itself, positionally,
+        // for delta pruning in the quiescence search
+        static constexpr int DELTA_MARGIN = 200;
+
+    private:
+        Transposition_Table tt;
+        Time_Manager clock;
+        int quiescence_checks;      // Plies of quiet checks searched at the horizon
+        uint64_t node_count;
+        bool stopped;               // Out of nodes or time, so unwind without a score
+        PackedMove root_best;       // Best move of the last finished iteration
+        PackedMove iteration_best;  // Best move so far in this iteration, null if none beat alpha
+
+        int aspiration_search(const int depth, const int previous);
+        bool count_node();
+        int search(const int depth, int alpha, const int beta, const int ply);
+        int quiesce(int alpha, const int beta, const int ply, const int checks);
+        int static_eval();
+        static int score_to_tt(const int score, const int ply);
+        static int score_from_tt(const int score, const int ply);
+        void order_moves(MoveList &moves, const PackedMove first) const;
+
+    public:
+        AlphaBetaEngine(Board& board, bool amWhite, const size_t hash_mb=DEFAULT_HASH_MB);
+
+        void set_hash_size(const size_t megabytes) override { tt.resize(megabytes); }
+        // Also search quiet checking moves for this many plies into the
+        // quiescence search; 0, the default, is captures and promotions only
+        void set_quiescence_checks(const int plies) { quiescence_checks = plies; }
+
+        PackedMove get_move(PackedMove opp_move) override;
+        // The position as it stands, in pawns for this engine's side
+        double evaluate() override;
+        void process_result(const bool I_win, const bool opponent_wins) override;
+        uint64_t nodes() const override { return node_count; }
+};
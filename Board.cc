@@ -1,9 +1,15 @@
 #include "Board.hh"
+#include "bitboard.hh"
+#include "attacks.hh"
+#include "zobrist.hh"
+#include "profile.hh"
 
 #include <cassert>
 #include <algorithm>
+#include <cctype>
 #include <iterator>
 #include <iostream>
+#include <sstream>
 
 const board_array START_BOARD = {
     'R','N','B','Q','K','B','N','R',
@@ -16,42 +22,80 @@ const board_array START_BOARD = {
     'r','n','b','q','k','b','n','r'
 };
 const std::string FILES = "abcdefgh";
-enum PLAYER {WHITE = true, BLACK = false};
+// Plain char array so it is ready before any other file's static Boards are built
+const char PIECE_CHARS[] = "PNBRQK";
+
+// Castling rights, one bit each
+enum CASTLE {WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8, ALL_CASTLES = 15};
+
+// Rights that survive something moving from or to each square, so moving a
+// king or rook (or capturing a rook at home) is a single AND
+constexpr std::array<uint8_t, 64> make_castle_masks() {
+    std::array<uint8_t, 64> masks{};
+    for (int i = 0; i < 64; ++i) {
+        masks[i] = ALL_CASTLES;
+    }
+    masks[A1] &= ~WHITE_OOO; masks[E1] &= ~(WHITE_OO | WHITE_OOO); masks[H1] &= ~WHITE_OO;
+    masks[A8] &= ~BLACK_OOO; masks[E8] &= ~(BLACK_OO | BLACK_OOO); masks[H8] &= ~BLACK_OO;
+    return masks;
+}
+constexpr std::array<uint8_t, 64> CASTLE_MASKS = make_castle_masks();
 
 class Board::Impl {
     private:
-        bool square_attacked(std::vector<Move> &opp_moves, std::string sqaure) const; // Check
-        bool is_legal_move(const Move m);                                   // Check
-        bool is_occupied(std::string square, const bool by_white) const;    // Check
-        bool is_occupied(std::string square) const;                         // Check
+        bool is_legal_move(const PackedMove m);                             // Check
+        bool is_occupied(const uint square, const bool by_white) const;     // Check
+        bool is_occupied(const uint square) const;                          // Check
         bool am_in_check(const bool am_white) const;                        // Check
-        std::vector<Move> knight_moves(std::string square) const;           // Check
-        std::vector<Move> pawn_moves(std::string square) const;             // Check
-        std::vector<Move> bishop_moves(std::string square) const;           // Check
-        std::vector<Move> rook_moves(std::string square) const;             // Check
-        std::vector<Move> queen_moves(std::string square) const;            // Check
-        std::vector<Move> king_moves(std::string square) const;             // Check
-        std::vector<Move> castleing(const bool am_white) const;             // Check
-        void execute_move(const Move m, char *capt_piece, char *mov_piece); // Check
-        bool threefold_rep(const std::string last) const;                   // Check
+        void add_moves(const uint square, bitboard targets, MoveList &ans) const; // Check
+        void knight_moves(const uint square, const bitboard mask, MoveList &ans) const; // Check
+        void pawn_moves(const uint square, const bitboard mask, MoveList &ans) const;   // Check
+        void ep_moves(const bool am_white, MoveList &ans) const;            // Check
+        void bishop_moves(const uint square, const bitboard mask, MoveList &ans) const; // Check
+        void rook_moves(const uint square, const bitboard mask, MoveList &ans) const;   // Check
+        void queen_moves(const uint square, const bitboard mask, MoveList &ans) const;  // Check
+        void king_moves(const uint square, MoveList &ans) const;            // Check
+        void legal_king_moves(const bool am_white, const bitboard mask, MoveList &ans) const; // Check
+        void legal_moves(const bool am_white, const bool captures_only, MoveList &ans); // Check
+        bitboard pinned(const bool am_white, bitboard pin_rays[64]) const;  // Check
+        void castleing(const bool am_white, MoveList &ans) const;           // Check
+        void put_piece(const uint square, const uint8_t piece);             // Check
+        void remove_piece(const uint square);                               // Check
+        void move_piece(const uint start, const uint end);                  // Check
+        void execute_move(const PackedMove m, uint8_t *capt_piece, uint8_t *mov_piece); // Check
+        void retract_move(const PackedMove m, const uint8_t capt_piece, const uint8_t mov_piece); // Check
+        bool threefold_rep() const;                                         // Check
+        bool fifty_moves() const;                                           // Check
+        bool has_legal_moves();                                             // Check
+        uint least_valuable(const bitboard attackers, const bool white, uint *type) const; // Check
+        bitboard xrays(const uint square, const bitboard occ) const;        // Check
+        uint64_t ep_key() const;                                            // Check
+        uint64_t compute_key() const;                                       // Check
     public:
-        board_array b;
+        bitboard pieces[2][6];              ///   One set per colour and piece type
+        bitboard occupied[2];               ///   Everything belonging to one colour
+        std::array<uint8_t, 64> squares;    ///   What piece is on each square, EMPTY if none
+        uint ep_square;                     ///   Square a pawn skipped over last move, if any
         bool turn;
-        std::vector<Move> moves;
-        std::string augmoves;
-        bool white_castle[3];  ///   A Rook has moved, King has moved, H Rook has moved
-        bool black_castle[3];
-        std::string white_king;
-        std::string black_king;
-        std::vector<std::string> past_states;
+        std::vector<PackedMove> moves;
+        std::vector<std::string> augmoves;  ///   Notation for each move that came through play_move
+        uint castling;                      ///   Castling rights left, CASTLE bits
+        uint halfmove;                      ///   Moves since the last capture or pawn move
+        uint64_t key;                       ///   Zobrist key of the position, kept up to date move by move
+        std::vector<uint64_t> past_states;  ///   Keys of every position so far, this one last
+        uint first_ply;                     ///   Plies played before the first position, for FEN move numbers
 
         Impl();                                                             // Check
         ~Impl();                                                            // Check
-        void play_move(Move mv);                                            // Check
-        std::vector<Move> get_past_moves() const;                           // Check
+        void reset();                                                       // Check
+        void play_move(PackedMove mv);                                      // Check
+        UndoInfo make_move(const PackedMove mv);                            // Check
+        void unmake_move(const PackedMove mv, const UndoInfo &undo);        // Check
+        std::vector<PackedMove> get_past_moves() const;                     // Check
         board_array get_board() const;                                      // Check
-        std::vector<Move> get_legal_moves(const bool amWhite);              // Check
-        std::vector<Move> get_moves(const bool am_white) const;             // Check
+        void get_legal_moves(const bool amWhite, MoveList &ans);            // Check
+        void get_captures(const bool am_white, MoveList &ans);              // Check
+        void get_moves(const bool am_white, MoveList &ans) const;           // Check
         std::string to_string() const;                                      // Check
         std::string move_string() const;                                    // Check
         bool game_over();                                                   // Check
@@ -59,7 +103,22 @@ class Board::Impl {
         bool black_wins();                                                  // Check
         bool is_white_turn() const;                                         // Check
         char get_square(std::string square) const;                          // Check
-        void set_board(const board_array &b);   
+        bitboard attackers_to(const uint square, const bitboard occ) const; // Check
+        bool is_square_attacked(const uint square, const bool by_white) const; // Check
+        bool in_check() const;                                              // Check
+        uint64_t key_after(const PackedMove mv) const;                      // Check
+        bool gives_check(const PackedMove mv) const;                        // Check
+        int see(const PackedMove mv) const;                                 // Check
+        bool see_ge(const PackedMove mv, const int threshold) const;        // Check
+        bool repeated() const;                                              // Check
+        uint king_square(const bool white) const;                           // Check
+        Move to_move(const PackedMove mv) const;                            // Check
+        PackedMove to_packed(const Move &mv) const;                         // Check
+        void set_board(const board_array &b);
+        bool set_fen(const std::string &fen);
+        std::string fen() const;
+        std::string san(const PackedMove mv);
+        PackedMove parse_san(const std::string &text);
 };
 
 // converts a string like "f6" into a board_array index like 47 (or whatever that would be)
@@ -74,549 +133,553 @@ const std::string to_square(const uint index) {
     int rank = (index / 8) % 8;
     char a = file + 'a';
     char b = rank + '1';
-    //std::cout << file << rank << std::string({a,b}) << std::endl;
-    return std::move(std::string({a, b}));
+    return std::string({a, b});
 }
 
-// converts a pair of coords like (0,7) into a string like "a8"
-const std::string to_square(const std::pair<int, int> &p){
-    char file = p.first + 'a';
-    char rank = p.second + '1';
-    //std::cout << std::string({file, rank}) << std::endl;
-    return std::move(std::string({file, rank}));
+// converts a piece like make_piece(BLACK, QUEEN) into its board_array character 'q'
+char to_char(const uint8_t piece) {
+    if (piece == EMPTY) {
+        return ' ';
+    }
+    char c = PIECE_CHARS[type_of(piece)];
+    return color_of(piece) == WHITE ? c : c + 32;
 }
 
-// same as above, but they aren't a tuple
-const std::string to_square(const uint file, const uint rank){
-    char a = file + 'a';
-    char b = rank + '1';
-    //std::cout << std::string({a,b}) << std::endl;
-    return std::move(std::string({a, b}));
+// converts a board_array character like 'q' into a piece, EMPTY if it isn't one
+uint8_t to_piece(const char c) {
+    for (int type = PAWN; type <= KING; ++type) {
+        if (c == PIECE_CHARS[type]) {
+            return make_piece(WHITE, type);
+        }
+        if (c == PIECE_CHARS[type] + 32) {
+            return make_piece(BLACK, type);
+        }
+    }
+    return EMPTY;
 }
 
-// constructor. all boards start out the same. unless this is like 
+// constructor. all boards start out the same. unless this is like
 // chess 960 or something and we don't worry about that
 Board::Impl::Impl() :
-    b(START_BOARD), turn{true}, moves(std::vector<Move>()),
-    white_castle{false, false, false}, black_castle{false, false, false},
-    white_king{"e1"}, black_king{"e8"}, augmoves{""}, 
-    past_states{std::string(START_BOARD.begin(), START_BOARD.end())}
-{}
+    turn{true}, moves(std::vector<PackedMove>()), augmoves(std::vector<std::string>()),
+    castling{ALL_CASTLES}, halfmove{0},
+    past_states(), first_ply{0}
+{
+    init_attacks();
+    set_board(START_BOARD);
+}
 
 Board::Impl::~Impl(){}
 
+// Back to the starting position. The history vectors are cleared rather than
+// replaced, so a board that is reset between games keeps their memory.
+void Board::Impl::reset() {
+    turn = true;
+    moves.clear();
+    augmoves.clear();
+    castling = ALL_CASTLES;
+    first_ply = 0;
+    set_board(START_BOARD);
+}
+
 // Checks whether a certain square is occupied by a certain side
-bool Board::Impl::is_occupied(std::string square, const bool am_white) const {
-    char me = b[to_index(square)];
-    if (me == ' ') {
-        return false;
-    }
-    return (me < 'a') == am_white;
+bool Board::Impl::is_occupied(const uint square, const bool am_white) const {
+    return occupied[am_white] & bit(square);
 }
 
 // Checks wheter there is anything in the square at all
-bool Board::Impl::is_occupied(std::string square) const {
-    char me = b[to_index(square)];
-    //std::cout << "is_occupied(" << square << "): " << (me != ' ') << " char is \'" << me << "\'" << std::endl;
-    return me != ' ';
+bool Board::Impl::is_occupied(const uint square) const {
+    return (occupied[WHITE] | occupied[BLACK]) & bit(square);
 }
 
 // What piece is on this square?
 char Board::Impl::get_square(std::string square) const {
-    return b[to_index(square)];
+    return to_char(squares[to_index(square)]);
 }
 
-// Calculates all possible knight moves. Figure out what they could be and then 
-// eliminate the bad ones.
-std::vector<Move> Board::Impl::knight_moves(std::string square) const {
-    short file = square[0] - 'a';
-    short rank = square[1] - '1';
-    char me = b[to_index(square)];
-    std::vector<Move> ans(0);
-    std::vector<std::pair<int, int>> pos(0);
-    pos.push_back(std::make_pair(file - 2, rank - 1));
-    pos.push_back(std::make_pair(file - 2, rank + 1));
-    pos.push_back(std::make_pair(file + 2, rank - 1));
-    pos.push_back(std::make_pair(file + 2, rank + 1));
-    pos.push_back(std::make_pair(file - 1, rank - 2));
-    pos.push_back(std::make_pair(file - 1, rank + 2));
-    pos.push_back(std::make_pair(file + 1, rank - 2));
-    pos.push_back(std::make_pair(file + 1, rank + 2));
-    for (auto const &p : pos) {
-        if (p.first >= 0 && p.first < 8 && p.second >= 0 && p.second < 8) {
-            std::string sq = to_square(p);
-            if (!is_occupied(sq, (me < 'a'))) {          /// Only add the square if it is not occupied by one of my teammates
-                ans.push_back({square, sq});
-            }
-        }
-    }
-    return ans;
+// Where is this side's king? (Derived from the king bitboard, so it never goes stale)
+uint Board::Impl::king_square(const bool white) const {
+    return lsb(pieces[white][KING]);
 }
 
-// Caculate the pawn moves
-std::vector<Move> Board::Impl::pawn_moves(std::string square) const {
-    std::vector<std::string> ans(0);
-    short file = square[0] - 'a';
-    short rank = square[1] - '1';
-    char me = b[to_index(square)];
-    // black pawns first
-    if (me == 'p') {
-        // Move one square forward, needs empty space
-        if (! is_occupied(to_square(file, rank - 1))) {
-            if ( rank > 1 ){
-                ans.push_back(to_square(file, rank - 1));
-                // Move 2 squares forward iff empty spaces and going from x7 to x5
-                if ( (rank == 6) && (!is_occupied(to_square(file, 4)))) {
-                        ans.push_back(to_square(file, 4));
-                }
-            } 
-        } 
-        // capturing left
-        if (file > 0) {
-            // standard capture
-            if (is_occupied(to_square(file - 1, rank - 1), true)) {
-                ans.push_back(to_square(file - 1, rank - 1));
-            }
-            // en passant
-            if (get_square(to_square(file - 1, 3)) == 'P' && rank == 3 &&
-                moves.back().start == to_square(file-1, 1) &&
-                moves.back().end == to_square(file-1, 3)) {
-                    ans.push_back(to_square(file - 1, 2));
-            }
-        }
-        // cpaturing right
-        if (file < 7) {
-            // standard capture
-            if (is_occupied(to_square(file + 1, rank - 1), true)) {
-                ans.push_back(to_square(file + 1, rank - 1));
-            }
-            // en passant
-            if (get_square(to_square(file + 1, 3)) == 'P' && rank == 3 &&
-                moves.back().start == to_square(file + 1, 1) &&
-                moves.back().end == to_square(file + 1, 3)) {
-                    ans.push_back(to_square(file + 1, 2));
-            }
-        }
-        // Promoting : for each move, replace with promoting to each piece
-        if (rank == 1) {
-            uint num_items = ans.size();
-            for(uint i = 0; i < num_items; ++i){
-                std::string m = ans[0];
-                ans.erase(ans.begin());
-                ans.push_back(m + "=Q");
-                ans.push_back(m + "=R");
-                ans.push_back(m + "=B");
-                ans.push_back(m + "=N");
-            }
-        }
-    } else if (me == 'P') {
-        if (! is_occupied(to_square(file, rank + 1))) {
-            if ( rank >= 1 ){
-                ans.push_back(to_square(file, rank + 1));
-                if ( (rank == 1) && (!is_occupied(to_square(file, 3)))) {
-                        ans.push_back(to_square(file, 3));
-                }
-            } 
-        }
-        // capturing left
-        if (file > 0) {
-            // standard capture
-            if (is_occupied(to_square(file - 1, rank + 1), false)) {
-                ans.push_back(to_square(file - 1, rank + 1));
-            }
-            // en passant
-            if (get_square(to_square(file - 1, 4)) == 'p' && rank == 4 &&
-                moves.back().start == to_square(file - 1, 6) &&
-                moves.back().end == to_square(file - 1, 4)) {
-                    ans.push_back(to_square(file - 1, 5));
-            }
-        }
-        // cpaturing right
-        if (file < 7) {
-            // standard capture
-            if (is_occupied(to_square(file + 1, rank + 1), false)) {
-                ans.push_back(to_square(file + 1, rank + 1));
-            }
-            // en passant
-            if (get_square(to_square(file + 1, 4)) == 'p' && rank == 4 &&
-                moves.back().start == to_square(file + 1, 6) &&
-                moves.back().end == to_square(file + 1, 4)) {
-                    ans.push_back(to_square(file + 1, 5));
-            }
-        }
-        if (rank == 6) {
-            uint num_items = ans.size();
-            for(uint i = 0; i < num_items; ++i){
-                std::string m = ans[0];
-                ans.erase(ans.begin());
-                ans.push_back(m + "=Q");
-                ans.push_back(m + "=R");
-                ans.push_back(m + "=B");
-                ans.push_back(m + "=N");
-            }
-        }
-    }
-    std::vector<Move> mvs(0);
-    for (const auto &dest : ans) {
-        mvs.push_back({square, dest});
-    }
-    return std::move(mvs);
+// Drop a piece onto an empty square, keeping the bitboards and the square array in step
+void Board::Impl::put_piece(const uint square, const uint8_t piece) {
+    pieces[color_of(piece)][type_of(piece)] |= bit(square);
+    occupied[color_of(piece)] |= bit(square);
+    squares[square] = piece;
+    key ^= ZOBRIST.pieces[piece][square];
 }
 
-// calculate bishop moves: from current position, travel out on the diagonals until
-// hit a wall or another piece (which I can maybe capture)
-std::vector<Move> Board::Impl::bishop_moves( std::string square ) const {
-    auto me = get_square(square);
-    bool player = me < 'a';
-    short file = square[0] - 'a';
-    short rank = square[1] - '1';
-    std::vector<Move> ans (0);
-    // down, left
-    short f = file; short r = rank;
-    while(f >= 1 && f < 8 && r >= 1 && r < 8){
-        f--; r--;
-        if (is_occupied(to_square(f, r), !player )) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        } if (is_occupied(to_square(f,r), player )) {
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
+// Lift whatever is on the square off the board
+void Board::Impl::remove_piece(const uint square) {
+    uint8_t piece = squares[square];
+    pieces[color_of(piece)][type_of(piece)] ^= bit(square);
+    occupied[color_of(piece)] ^= bit(square);
+    squares[square] = EMPTY;
+    key ^= ZOBRIST.pieces[piece][square];
+}
+
+// Slide a piece to an empty square
+void Board::Impl::move_piece(const uint start, const uint end) {
+    uint8_t piece = squares[start];
+    bitboard both = bit(start) | bit(end);
+    pieces[color_of(piece)][type_of(piece)] ^= both;
+    occupied[color_of(piece)] ^= both;
+    squares[start] = EMPTY;
+    squares[end] = piece;
+    key ^= ZOBRIST.pieces[piece][start] ^ ZOBRIST.pieces[piece][end];
+}
+
+// Turn a set of destination squares into moves from the given square, flagging
+// the ones that land on an opponent's piece as captures
+void Board::Impl::add_moves(const uint square, bitboard targets, MoveList &ans) const {
+    bitboard enemy = occupied[!color_of(squares[square])];
+    while (targets) {
+        uint end = pop_lsb(targets);
+        ans.push_back(PackedMove(square, end, (enemy & bit(end)) ? PackedMove::CAPTURE : PackedMove::QUIET));
     }
-    // down, right
-    f = file; r = rank;
-    while(f >= 0 && f < 7 && r >= 1 && r < 8){
-        f++; r--;
-        if (is_occupied(to_square(f, r), !player )) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        } if (is_occupied(to_square(f,r), player )) {
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
+}
+
+// The piece generators below only make moves that end on a square in $mask.
+// get_moves passes every square; get_legal_moves uses it to keep pinned
+// pieces on their pin and to make everything else answer a check.
+const bitboard ALL_SQUARES = ~0ULL;
+
+// Knight moves: any of the eight jumps that doesn't land on one of my teammates
+void Board::Impl::knight_moves(const uint square, const bitboard mask, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    add_moves(square, KNIGHT_ATTACKS[square] & ~occupied[player] & mask, ans);
+}
+
+// Caculate the pawn moves, apart from en passant
+void Board::Impl::pawn_moves(const uint square, const bitboard mask, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    bitboard from = bit(square);
+    bitboard empty = ~(occupied[WHITE] | occupied[BLACK]);
+    bitboard one, two;
+    // Move one square forward, needs empty space. Move 2 squares forward iff
+    // empty spaces and going from x2 to x4 (or x7 to x5)
+    if (player == WHITE) {
+        one = north(from) & empty;
+        two = north(one) & empty & RANK_4;
+    } else {
+        one = south(from) & empty;
+        two = south(one) & empty & RANK_5;
     }
-    // up, left
-    f = file; r = rank;
-    while(f >= 1 && f < 8 && r >= 0 && r < 7){
-        f--; r++;
-        if (is_occupied(to_square(f, r), !player )) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        } if (is_occupied(to_square(f,r), player )) {
-            break;
+    one &= mask;
+    two &= mask;
+    // standard captures
+    bitboard captures = PAWN_ATTACKS[player][square] & occupied[!player] & mask;
+    // Promoting : for each move, replace with promoting to each piece
+    if ((one | captures) & (RANK_1 | RANK_8)) {
+        bitboard targets = one | captures;
+        while (targets) {
+            uint end = pop_lsb(targets);
+            uint capt = (captures & bit(end)) ? PackedMove::CAPTURE : PackedMove::QUIET;
+            ans.push_back(PackedMove(square, end, PackedMove::PROMO_Q | capt));
+            ans.push_back(PackedMove(square, end, PackedMove::PROMO_R | capt));
+            ans.push_back(PackedMove(square, end, PackedMove::PROMO_B | capt));
+            ans.push_back(PackedMove(square, end, PackedMove::PROMO_N | capt));
         }
-        ans.push_back({square, to_square(f,r)});
+        return;
     }
-    // up, right
-    f = file; r = rank;
-    while(f >= 0 && f < 7 && r >= 0 && r < 7){
-        f++; r++;
-        if (is_occupied(to_square(f, r), !player )) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        } if (is_occupied(to_square(f,r), player )) {
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
+    add_moves(square, one | captures, ans);
+    if (two) {
+        ans.push_back(PackedMove(square, lsb(two), PackedMove::DOUBLE_PUSH));
     }
-    return ans;
 }
 
-// calculate rook moves, similar to bishoping
-std::vector<Move> Board::Impl::rook_moves(std::string square) const {
-    auto me = get_square(square);
-    bool player = me < 'a';
-    short file = square[0] - 'a';
-    short rank = square[1] - '1';
-    std::vector<Move> ans (0);
-    // left
-    short f = file; short r = rank;
-    while (f > 0) {
-        f--;
-        if (is_occupied(to_square(f,r), player)) {
-            break;
-        }
-        if (is_occupied(to_square(f,r), !player)) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
-    }
-    // right
-    f = file; r = rank;
-    while (f < 7) {
-        f++;
-        if (is_occupied(to_square(f,r), player)) {
-            break;
-        }
-        if (is_occupied(to_square(f,r), !player)) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
-    }
-    // down
-    f = file; r = rank;
-    while (r > 0) {
-        r--;
-        if (is_occupied(to_square(f,r), player)) {
-            break;
-        }
-        if (is_occupied(to_square(f,r), !player)) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
+// en passant, only against the pawn that just moved two squares, and only by
+// the side whose turn it is (the square is on rank 6 when white can take)
+void Board::Impl::ep_moves(const bool am_white, MoveList &ans) const {
+    if (ep_square == NO_SQUARE || (ep_square >= 32) != am_white) {
+        return;
     }
-    // up
-    f = file; r = rank;
-    while (r < 7) {
-        r++;
-        if (is_occupied(to_square(f,r), player)) {
-            break;
-        }
-        if (is_occupied(to_square(f,r), !player)) {
-            ans.push_back({square, to_square(f,r)});
-            break;
-        }
-        ans.push_back({square, to_square(f,r)});
+    bitboard takers = PAWN_ATTACKS[!am_white][ep_square] & pieces[am_white][PAWN];
+    while (takers) {
+        ans.push_back(PackedMove(pop_lsb(takers), ep_square, PackedMove::EP_CAPTURE));
     }
-    return ans;
+}
+
+// calculate bishop moves: from current position, travel out on the diagonals until
+// hit a wall or another piece (which I can maybe capture)
+void Board::Impl::bishop_moves(const uint square, const bitboard mask, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    bitboard targets = bishop_attacks(square, occupied[WHITE] | occupied[BLACK]);
+    add_moves(square, targets & ~occupied[player] & mask, ans);
+}
+
+// calculate rook moves, similar to bishoping
+void Board::Impl::rook_moves(const uint square, const bitboard mask, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    bitboard targets = rook_attacks(square, occupied[WHITE] | occupied[BLACK]);
+    add_moves(square, targets & ~occupied[player] & mask, ans);
 }
 
 // Queen: Rook moves + Bishop moves
-std::vector<Move> Board::Impl::queen_moves(std::string square) const {
-    auto v1 = bishop_moves(square);
-    auto v2 = rook_moves(square);
-    v1.insert(v1.end(), v2.begin(), v2.end());
-    return v1;
+void Board::Impl::queen_moves(const uint square, const bitboard mask, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    bitboard targets = queen_attacks(square, occupied[WHITE] | occupied[BLACK]);
+    add_moves(square, targets & ~occupied[player] & mask, ans);
 }
 
 // King: one square in any direction, no castling calculated here
-std::vector<Move> Board::Impl::king_moves(std::string square) const {
-    char me = get_square(square);
-    bool player = me < 'a';
-    short file = square[0] - 'a';
-    short rank = square[1] - '1';
-    std::vector<std::pair<int, int>> coords({
-        std::make_pair(file + 1, rank + 1),
-        std::make_pair(file    , rank + 1),
-        std::make_pair(file - 1, rank + 1),
-        std::make_pair(file + 1, rank    ),
-        std::make_pair(file - 1, rank    ),
-        std::make_pair(file + 1, rank - 1),
-        std::make_pair(file    , rank - 1),
-        std::make_pair(file - 1, rank - 1)
-    });
-    std::vector<Move> ans(0);
-    for (const std::pair<int, int> &p : coords) {
-        if (
-            p.first < 8 && p.first >= 0 &&
-            p.second < 8 && p.second >= 0 &&
-            ! is_occupied(to_square(p), player)
-        ) {
-            ans.push_back({square, to_square(p)});
+void Board::Impl::king_moves(const uint square, MoveList &ans) const {
+    bool player = color_of(squares[square]);
+    add_moves(square, KING_ATTACKS[square] & ~occupied[player], ans);
+}
+
+// King moves that don't step into an attack, ending in $mask. The king is lifted
+// off the board first, so a slider checking it along a line still covers the
+// square behind it.
+void Board::Impl::legal_king_moves(const bool am_white, const bitboard mask, MoveList &ans) const {
+    uint king = king_square(am_white);
+    bitboard occ = (occupied[WHITE] | occupied[BLACK]) ^ bit(king);
+    bitboard enemy = occupied[!am_white];
+    bitboard targets = KING_ATTACKS[king] & ~occupied[am_white] & mask;
+    while (targets) {
+        uint end = pop_lsb(targets);
+        if (!(attackers_to(end, occ) & enemy)) {
+            ans.push_back(PackedMove(king, end, (enemy & bit(end)) ? PackedMove::CAPTURE : PackedMove::QUIET));
         }
     }
-    return ans;
 }
 
-// Given that the opponent can make the moves in $moves, can they
-// move anything to $square
-bool Board::Impl::square_attacked(std::vector<Move> &moves, std::string square) const {
-    for (const Move &mv : moves) {
-        if (mv.end.rfind(square, 0) != -1) {
-            if (get_square(mv.start) % 32 != 'P' % 32 || mv.start[0] != square[0]) {
-                return true;
-            }
+// My pieces that are the only thing between my king and an enemy slider
+// pointing at it. For each one, pin_rays gets the squares it can still move
+// to: the line up to and including the slider.
+bitboard Board::Impl::pinned(const bool am_white, bitboard pin_rays[64]) const {
+    uint king = king_square(am_white);
+    bitboard occ = occupied[WHITE] | occupied[BLACK];
+    bitboard enemy = occupied[!am_white];
+    // Enemy sliders that would see the king if only enemy pieces were in the way
+    bitboard snipers =
+        (rook_attacks(king, enemy) & (pieces[!am_white][ROOK] | pieces[!am_white][QUEEN])) |
+        (bishop_attacks(king, enemy) & (pieces[!am_white][BISHOP] | pieces[!am_white][QUEEN]));
+    bitboard ans = 0;
+    while (snipers) {
+        uint sniper = pop_lsb(snipers);
+        bitboard blockers = BETWEEN[king][sniper] & occ;
+        if (popcount(blockers) == 1 && (blockers & occupied[am_white])) {
+            ans |= blockers;
+            pin_rays[lsb(blockers)] = BETWEEN[king][sniper] | bit(sniper);
         }
     }
-    return false;
+    return ans;
+}
+
+// Every piece of either colour that attacks $square, if the board were
+// filled in as $occ. Looks outwards from the square with each piece's own
+// attack pattern: if a knight on the square could reach a knight, that
+// knight can reach the square, and the same goes for the rest (pawns look
+// the opposite way to how they capture).
+bitboard Board::Impl::attackers_to(const uint square, const bitboard occ) const {
+    bitboard diagonal = pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    bitboard straight = pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    return (PAWN_ATTACKS[BLACK][square] & pieces[WHITE][PAWN]) |
+           (PAWN_ATTACKS[WHITE][square] & pieces[BLACK][PAWN]) |
+           (KNIGHT_ATTACKS[square] & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT])) |
+           (KING_ATTACKS[square] & (pieces[WHITE][KING] | pieces[BLACK][KING])) |
+           (bishop_attacks(square, occ) & diagonal) |
+           (rook_attacks(square, occ) & straight);
+}
+
+// Could the given side capture something on $square? Pawns count whether or
+// not there is anything there to take.
+bool Board::Impl::is_square_attacked(const uint square, const bool by_white) const {
+    return attackers_to(square, occupied[WHITE] | occupied[BLACK]) & occupied[by_white];
 }
 
 // Castling.... Ooo boy.
-std::vector<Move> Board::Impl::castleing(bool am_white) const {
-    std::vector<Move> ans(0);
-    std::vector<Move> opp_moves = get_moves(!am_white);
+void Board::Impl::castleing(bool am_white, MoveList &ans) const {
+    PROFILE_SCOPE(PROFILE_CASTLEING);
+    /// No castling if the king has moved
+    if (!(castling & (am_white ? WHITE_OO | WHITE_OOO : BLACK_OO | BLACK_OOO))) {
+        return;
+    }
     if (am_white){
-        /// No castling if the king has moved, no castling out of check
-        if (white_castle[1] || square_attacked(opp_moves, "e1")) {
-            return ans;
+        /// No castling out of check
+        if (is_square_attacked(E1, BLACK)) {
+            return;
         }
         /// Queenside Castle
         /// None of the squares are occupied by anyone, and no castling into or through check
-        if (! white_castle[0] &&
-            ! is_occupied("b1") && 
-            ! is_occupied("c1") && !square_attacked(opp_moves, "c1") &&
-            ! is_occupied("d1") && !square_attacked(opp_moves, "d1") &&
-            ! (get_square("e2") == 'p') && ! (get_square("b2") == 'p')) {
-                ans.push_back({"e1","c1"});
+        if ((castling & WHITE_OOO) &&
+            ! is_occupied(B1) &&
+            ! is_occupied(C1) && !is_square_attacked(C1, BLACK) &&
+            ! is_occupied(D1) && !is_square_attacked(D1, BLACK)) {
+                ans.push_back(PackedMove(E1, C1, PackedMove::QUEEN_CASTLE));
         }
         /// Kingside Castle
         /// Same dealio
-        if (! white_castle[2] &&
-            ! is_occupied("f1") && !square_attacked(opp_moves, "f1") &&
-            ! is_occupied("g1") && !square_attacked(opp_moves, "g1") &&
-            ! (get_square("e2") == 'p') && ! (get_square("h2") == 'p')) {
-                ans.push_back({"e1","g1"});
+        if ((castling & WHITE_OO) &&
+            ! is_occupied(F1) && !is_square_attacked(F1, BLACK) &&
+            ! is_occupied(G1) && !is_square_attacked(G1, BLACK)) {
+                ans.push_back(PackedMove(E1, G1, PackedMove::KING_CASTLE));
         }
     } else {
-        /// No castling if the king has moved, no castling out of check
-        if (black_castle[1] || square_attacked(opp_moves, "e8")) {
-            return ans;
+        /// No castling out of check
+        if (is_square_attacked(E8, WHITE)) {
+            return;
         }
         /// Queenside Castle
         /// None of the squares are occupied by anyone, and no castling into or through check
-        if (! black_castle[0] &&
-            ! is_occupied("b8") && 
-            ! is_occupied("c8") && !square_attacked(opp_moves, "c8") &&
-            ! is_occupied("d8") && !square_attacked(opp_moves, "d8") &&
-            ! (get_square("e7") == 'P') && ! (get_square("b7") == 'P')) {
-                ans.push_back({"e8","c8"});
+        if ((castling & BLACK_OOO) &&
+            ! is_occupied(B8) &&
+            ! is_occupied(C8) && !is_square_attacked(C8, WHITE) &&
+            ! is_occupied(D8) && !is_square_attacked(D8, WHITE)) {
+                ans.push_back(PackedMove(E8, C8, PackedMove::QUEEN_CASTLE));
         }
         /// Kingside Castle
         /// Same dealio
-        if (! black_castle[2] &&
-            ! is_occupied("f8") && !square_attacked(opp_moves, "f8") &&
-            ! is_occupied("g8") && !square_attacked(opp_moves, "g8") &&
-            ! (get_square("e7") == 'P') && ! (get_square("h7") == 'P')) {
-                ans.push_back({"e8","g8"});
+        if ((castling & BLACK_OO) &&
+            ! is_occupied(F8) && !is_square_attacked(F8, WHITE) &&
+            ! is_occupied(G8) && !is_square_attacked(G8, WHITE)) {
+                ans.push_back(PackedMove(E8, G8, PackedMove::KING_CASTLE));
         }
     }
-    return ans;
 }
 
-/// Go through each square on the board. If it is one of my pieces, figure out where
+/// Go through each of my piece sets. For each piece, figure out where
 /// it can go. Don't worry about whether the move is legal from a checking perspective.
 /// Also don't compute castling. This method is mainly used to determing whether there
 /// are checks on the board, so castling will never matter
-std::vector<Move> Board::Impl::get_moves(const bool am_white) const {
-    std::vector<Move> ans(0);
-    for(uint i = 0; i < 64; ++i) {
-        char piece = b[i];
-        if ((piece < 'a') == am_white) {
-            if (piece % 32 == 'P' % 32) {
-                auto v = pawn_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            } else if (piece % 32 == 'B' % 32) {
-                auto v = bishop_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            } else if (piece % 32 == 'N' % 32) {
-                auto v = knight_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            } else if (piece % 32 == 'R' % 32) {
-                auto v = rook_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            } else if (piece % 32 == 'Q' % 32) {
-                auto v = queen_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            } else if (piece % 32 == 'K' % 32) {
-                auto v = king_moves(to_square(i));
-                ans.insert(ans.end(), v.begin(), v.end());
-            }
-        }
+void Board::Impl::get_moves(const bool am_white, MoveList &ans) const {
+    bitboard bb = pieces[am_white][PAWN];
+    while (bb) {
+        pawn_moves(pop_lsb(bb), ALL_SQUARES, ans);
+    }
+    ep_moves(am_white, ans);
+    bb = pieces[am_white][KNIGHT];
+    while (bb) {
+        knight_moves(pop_lsb(bb), ALL_SQUARES, ans);
+    }
+    bb = pieces[am_white][BISHOP];
+    while (bb) {
+        bishop_moves(pop_lsb(bb), ALL_SQUARES, ans);
+    }
+    bb = pieces[am_white][ROOK];
+    while (bb) {
+        rook_moves(pop_lsb(bb), ALL_SQUARES, ans);
+    }
+    bb = pieces[am_white][QUEEN];
+    while (bb) {
+        queen_moves(pop_lsb(bb), ALL_SQUARES, ans);
+    }
+    bb = pieces[am_white][KING];
+    while (bb) {
+        king_moves(pop_lsb(bb), ans);
     }
-    return ans;
 }
 
-/// See what my opponent's moves are. If any of them capture the king, I'm in check
+/// If my opponent attacks my king, I'm in check. A board with no king of mine
+/// on it (only ever set up by hand) is never in check.
 bool Board::Impl::am_in_check(const bool am_white) const {
-    auto opp_moves = get_moves(! am_white);
-    if (am_white) {
-        return square_attacked(opp_moves, white_king);
-    } else {
-        return square_attacked(opp_moves, black_king);
+    if (!pieces[am_white][KING]) {
+        return false;
     }
+    return is_square_attacked(king_square(am_white), !am_white);
 }
 
-/// Make a move, recording what (if any) piece was captured, also what piece was moved
-void Board::Impl::execute_move(const Move m, char *capt_piece, char *mov_piece) {
-    *capt_piece = get_square(m.end);
-    *mov_piece = get_square(m.start);
-    b[to_index(m.start)] = ' ';
-    if (m.end.size() != 2) {
-        b[to_index(m.end)] = m.end[3];
+/// Make a move, recording what (if any) piece was captured, also what piece was moved.
+/// Castling also brings the rook across.
+void Board::Impl::execute_move(const PackedMove m, uint8_t *capt_piece, uint8_t *mov_piece) {
+    PROFILE_SCOPE(PROFILE_EXECUTE_MOVE);
+    uint start = m.start();
+    uint end = m.end();
+    *capt_piece = squares[end];
+    *mov_piece = squares[start];
+    if (*capt_piece != EMPTY) {
+        remove_piece(end);
+    }
+    if (m.is_promotion()) {
+        remove_piece(start);
+        put_piece(end, make_piece(color_of(*mov_piece), m.promotion()));
     } else {
-        b[to_index(m.end)] = *mov_piece;
+        move_piece(start, end);
     }
     // en passant makes everything more complicated
-    if ((*mov_piece == 'p' || *mov_piece == 'P') &&
-        (m.start[0] != m.end[0]) && (*capt_piece == ' ')) {
-        *capt_piece = '!';
-        if( *mov_piece == 'p'){
-            b[to_index(std::string({m.end[0], '4'}))] = ' ';
-        } else {
-            b[to_index(std::string({m.end[0], '5'}))] = ' ';
-        }
+    if (m.flag() == PackedMove::EP_CAPTURE) {
+        uint victim = color_of(*mov_piece) == BLACK ? end + 8 : end - 8;
+        *capt_piece = squares[victim];
+        remove_piece(victim);
+    } else if (m.flag() == PackedMove::KING_CASTLE) {
+        move_piece(start + 3, start + 1);
+    } else if (m.flag() == PackedMove::QUEEN_CASTLE) {
+        move_piece(start - 4, start - 1);
     }
 }
 
-/// Test out a move with execute_move, then see if I'm in check.
-/// Then put the board back together. Use to see if a given move is 
-/// legal, i.e. if performing it leads to the opponent capturing the king.
-/// Again, castling is computed separately, and already checks for the various legalities
-bool Board::Impl::is_legal_move(const Move m) {
-    char capt_piece;
-    char mov_piece;
-    execute_move(m, &capt_piece, &mov_piece);
-    bool ans;
-    if (mov_piece == 'k' || mov_piece == 'K'){
-        auto opp_moves = get_moves(mov_piece > 'a');
-        ans = square_attacked(opp_moves, m.end);
+/// Put the pieces back the way they were before execute_move
+void Board::Impl::retract_move(const PackedMove m, const uint8_t capt_piece, const uint8_t mov_piece) {
+    uint start = m.start();
+    uint end = m.end();
+    if (m.is_promotion()) {
+        remove_piece(end);
+        put_piece(start, mov_piece);
     } else {
-        ans = am_in_check(mov_piece < 'a');
+        move_piece(end, start);
     }
-    b[to_index(m.start)] = mov_piece;
     // Again en passant makes everything more complicated
-    if (capt_piece != '!') {
-        b[to_index(m.end)] = capt_piece;
-    } else {
-        b[to_index(m.end)] = ' ';
-        if( mov_piece == 'p'){
-            b[to_index(std::string({m.end[0], '4'}))] = 'P';
-        } else {
-            b[to_index(std::string({m.end[0], '5'}))] = 'p';
-        }
+    if (m.flag() == PackedMove::EP_CAPTURE) {
+        put_piece(color_of(mov_piece) == BLACK ? end + 8 : end - 8, capt_piece);
+    } else if (capt_piece != EMPTY) {
+        put_piece(end, capt_piece);
+    } else if (m.flag() == PackedMove::KING_CASTLE) {
+        move_piece(start + 1, start + 3);
+    } else if (m.flag() == PackedMove::QUEEN_CASTLE) {
+        move_piece(start - 1, start - 4);
     }
+}
+
+/// Test out a move with execute_move, then see if my king is attacked.
+/// Then put the board back together. Use to see if a given move is
+/// legal, i.e. if performing it leads to the opponent capturing the king.
+/// Again, castling is computed separately, and already checks for the various legalities
+bool Board::Impl::is_legal_move(const PackedMove m) {
+    uint8_t capt_piece;
+    uint8_t mov_piece;
+    execute_move(m, &capt_piece, &mov_piece);
+    bool ans = am_in_check(color_of(mov_piece));
+    retract_move(m, capt_piece, mov_piece);
     return !ans;
 }
 
 /// Returns the move history of the game
-std::vector<Move> Board::Impl::get_past_moves() const {
+std::vector<PackedMove> Board::Impl::get_past_moves() const {
     return moves;
 }
 
 /// Returns the board in array form
 board_array Board::Impl::get_board() const {
+    board_array b;
+    for (uint i = 0; i < 64; ++i) {
+        b[i] = to_char(squares[i]);
+    }
     return b;
 }
 
-/// Returns all legal moves in the position
-std::vector<Move> Board::Impl::get_legal_moves(const bool am_white) {
-    
-    auto v = get_moves(am_white);
-    std::vector<Move> ans(0);
-    for(uint i = 0; i < v.size(); ++i) {  
-        if (is_legal_move(v[i])) {
-            ans.push_back({v[i].start,v[i].end});
+/// Returns all legal moves in the position, in one pass over my pieces.
+/// Works out once what is checking my king and what is pinned to it:
+///  - in double check only the king can move
+///  - in check everything else has to take the checker or block it
+///  - a pinned piece has to stay on the line of its pin
+/// En passant can uncover a check along the rank through both pawns, which no
+/// pin catches, so those few moves are tried out with is_legal_move instead.
+void Board::Impl::get_legal_moves(const bool am_white, MoveList &ans) {
+    legal_moves(am_white, false, ans);
+}
+
+/// Only the legal captures and promotions (including en passant, and pushes
+/// that promote), for a quiescence search
+void Board::Impl::get_captures(const bool am_white, MoveList &ans) {
+    legal_moves(am_white, true, ans);
+}
+
+void Board::Impl::legal_moves(const bool am_white, const bool captures_only, MoveList &ans) {
+    PROFILE_SCOPE(PROFILE_LEGAL_MOVES);
+    // Boards set up by hand might have no king to keep out of check
+    if (!pieces[am_white][KING] && !captures_only) {
+        get_moves(am_white, ans);
+        return;
+    }
+    if (!pieces[am_white][KING]) {
+        MoveList all;
+        get_moves(am_white, all);
+        for (const PackedMove &m : all) {
+            if (m.is_capture() || m.is_promotion()) {
+                ans.push_back(m);
+            }
         }
+        return;
+    }
+    // Everything but pawns can only capture onto enemy pieces; pawns can also
+    // promote by moving straight on
+    bitboard targets = captures_only ? occupied[!am_white] : ALL_SQUARES;
+    bitboard pawn_targets = captures_only ? targets | RANK_1 | RANK_8 : ALL_SQUARES;
+    uint king = king_square(am_white);
+    bitboard checkers = attackers_to(king, occupied[WHITE] | occupied[BLACK]) & occupied[!am_white];
+    legal_king_moves(am_white, targets, ans);
+    if (popcount(checkers) > 1) {
+        return;
+    }
+    bitboard check_mask = ALL_SQUARES;
+    if (checkers) {
+        check_mask = checkers | BETWEEN[king][lsb(checkers)];
+    }
+    bitboard pin_rays[64];
+    bitboard pins = pinned(am_white, pin_rays);
+
+    bitboard bb = pieces[am_white][PAWN];
+    while (bb) {
+        uint sq = pop_lsb(bb);
+        pawn_moves(sq, pawn_targets & ((pins & bit(sq)) ? check_mask & pin_rays[sq] : check_mask), ans);
     }
-    auto castles = castleing(am_white);
-    for(const Move & m : castles) {  
+    check_mask &= targets;
+    // A pinned knight can never move
+    bb = pieces[am_white][KNIGHT] & ~pins;
+    while (bb) {
+        knight_moves(pop_lsb(bb), check_mask, ans);
+    }
+    bb = pieces[am_white][BISHOP];
+    while (bb) {
+        uint sq = pop_lsb(bb);
+        bishop_moves(sq, (pins & bit(sq)) ? check_mask & pin_rays[sq] : check_mask, ans);
+    }
+    bb = pieces[am_white][ROOK];
+    while (bb) {
+        uint sq = pop_lsb(bb);
+        rook_moves(sq, (pins & bit(sq)) ? check_mask & pin_rays[sq] : check_mask, ans);
+    }
+    bb = pieces[am_white][QUEEN];
+    while (bb) {
+        uint sq = pop_lsb(bb);
+        queen_moves(sq, (pins & bit(sq)) ? check_mask & pin_rays[sq] : check_mask, ans);
+    }
+    MoveList ep;
+    ep_moves(am_white, ep);
+    for (const PackedMove &m : ep) {
         if (is_legal_move(m)) {
-            ans.push_back(std::move(m));
+            ans.push_back(m);
         }
     }
-    return std::move(ans);
+    if (!checkers && !captures_only) {
+        castleing(am_white, ans);
+    }
 }
 
-bool is_in_list_of_moves(std::vector<Move> mv_ls, const Move mv) {
-    for (const Move &m : mv_ls){
-        if (m.start == mv.start && m.end == mv.end) { 
-            return true;
-        }
-    } 
-    return false;
+bool is_in_list_of_moves(const MoveList &mv_ls, const PackedMove mv) {
+    return std::find(mv_ls.begin(), mv_ls.end(), mv) != mv_ls.end();
+}
+
+/// Spell a packed move out as strings, like {"e7","f8=Q"}
+Move Board::Impl::to_move(const PackedMove mv) const {
+    std::string end = to_square(mv.end());
+    if (mv.is_promotion()) {
+        end += "=";
+        end += PIECE_CHARS[mv.promotion()];
+    }
+    return {to_square(mv.start()), end};
+}
+
+/// Pack a string move, reading the flags off the current position
+PackedMove Board::Impl::to_packed(const Move &mv) const {
+    uint start = to_index(mv.start);
+    uint end = to_index(mv.end);
+    uint8_t piece = squares[start];
+    uint flag = squares[end] != EMPTY ? PackedMove::CAPTURE : PackedMove::QUIET;
+    if (mv.end.size() > 3) {
+        flag |= PackedMove::PROMOTION | (type_of(to_piece(mv.end[3])) - KNIGHT);
+    } else if (type_of(piece) == KING && end == start + 2) {
+        flag = PackedMove::KING_CASTLE;
+    } else if (type_of(piece) == KING && end + 2 == start) {
+        flag = PackedMove::QUEEN_CASTLE;
+    } else if (type_of(piece) == PAWN && (start ^ end) == 16) {
+        flag = PackedMove::DOUBLE_PUSH;
+    } else if (type_of(piece) == PAWN && end == ep_square && (start % 8) != (end % 8)) {
+        flag = PackedMove::EP_CAPTURE;
+    }
+    return PackedMove(start, end, flag);
 }
 
 std::string upper(char c) {
@@ -626,107 +689,338 @@ std::string upper(char c) {
     return std::string(1, c);
 }
 
-/// Plays the given move
-void Board::Impl::play_move(const Move mv){
+/// Make the move for real: move the pieces, then bring the castling rights,
+/// en passant square, halfmove clock and history along. Returns everything
+/// unmake_move needs to put it all back.
+UndoInfo Board::Impl::make_move(const PackedMove mv) {
+    PROFILE_SCOPE(PROFILE_MAKE_MOVE);
+    UndoInfo undo;
+    undo.hash = key;
+    undo.castling = castling;
+    undo.ep_square = ep_square;
+    undo.halfmove = halfmove;
+    uint8_t mov;
+    // Take the old castling rights and en passant file out of the key
+    key ^= ZOBRIST.castling[castling] ^ ep_key();
+    execute_move(mv, &undo.captured, &mov);
+    // If a rook or king moved (or a rook was taken), those castles are gone
+    castling &= CASTLE_MASKS[mv.start()] & CASTLE_MASKS[mv.end()];
+    // If a pawn moved two squares, remember the square it skipped for en passant
+    ep_square = NO_SQUARE;
+    if (mv.flag() == PackedMove::DOUBLE_PUSH) {
+        ep_square = (mv.start() + mv.end()) / 2;
+    }
+    if (type_of(mov) == PAWN || undo.captured != EMPTY) {
+        halfmove = 0;
+    } else {
+        ++halfmove;
+    }
+    moves.push_back(mv);
+    // Increment whose turn it is now
+    turn = !turn;
+    key ^= ZOBRIST.castling[castling] ^ ep_key() ^ ZOBRIST.black_to_move;
+    // Add this board state to the bank of previous board states
+    past_states.push_back(key);
+    return undo;
+}
+
+/// The key make_move would leave, worked out without moving anything, so a
+/// search can start fetching the child's table entry before it gets there
+uint64_t Board::Impl::key_after(const PackedMove mv) const {
+    uint start = mv.start();
+    uint end = mv.end();
+    uint8_t piece = squares[start];
+    uint64_t ans = key ^ ZOBRIST.castling[castling] ^ ep_key() ^ ZOBRIST.black_to_move;
+    if (squares[end] != EMPTY) {
+        ans ^= ZOBRIST.pieces[squares[end]][end];
+    }
+    uint8_t landed = mv.is_promotion() ? make_piece(turn, mv.promotion()) : piece;
+    ans ^= ZOBRIST.pieces[piece][start] ^ ZOBRIST.pieces[landed][end];
+    if (mv.flag() == PackedMove::EP_CAPTURE) {
+        ans ^= ZOBRIST.pieces[make_piece(!turn, PAWN)][turn ? end - 8 : end + 8];
+    } else if (mv.flag() == PackedMove::KING_CASTLE) {
+        uint8_t rook = make_piece(turn, ROOK);
+        ans ^= ZOBRIST.pieces[rook][start + 3] ^ ZOBRIST.pieces[rook][start + 1];
+    } else if (mv.flag() == PackedMove::QUEEN_CASTLE) {
+        uint8_t rook = make_piece(turn, ROOK);
+        ans ^= ZOBRIST.pieces[rook][start - 4] ^ ZOBRIST.pieces[rook][start - 1];
+    }
+    ans ^= ZOBRIST.castling[castling & CASTLE_MASKS[start] & CASTLE_MASKS[end]];
+    // The same test as ep_key, from the other side's point of view
+    if (mv.flag() == PackedMove::DOUBLE_PUSH) {
+        uint ep = (start + end) / 2;
+        if (PAWN_ATTACKS[turn][ep] & pieces[!turn][PAWN]) {
+            ans ^= ZOBRIST.ep_file[ep % 8];
+        }
+    }
+    return ans;
+}
+
+/// Whether the move would leave the other side in check, worked out from
+/// the attack tables without moving anything. The other side isn't in check
+/// now, so only the piece that lands (or the rook, castling) can check
+/// directly; any other check is discovered, by a slider seeing past the
+/// square the piece left.
+bool Board::Impl::gives_check(const PackedMove mv) const {
+    if (!pieces[!turn][KING]) {
+        return false;
+    }
+    uint start = mv.start();
+    uint end = mv.end();
+    uint ksq = king_square(!turn);
+    uint landed = mv.is_promotion() ? mv.promotion() : type_of(squares[start]);
+    bitboard occ = ((occupied[WHITE] | occupied[BLACK]) ^ bit(start)) | bit(end);
+    // Our sliders after the move, by the lines they move along
+    bitboard diagonal = (pieces[turn][BISHOP] | pieces[turn][QUEEN]) & ~bit(start);
+    bitboard straight = (pieces[turn][ROOK] | pieces[turn][QUEEN]) & ~bit(start);
+    if (landed == BISHOP || landed == QUEEN) {
+        diagonal |= bit(end);
+    }
+    if (landed == ROOK || landed == QUEEN) {
+        straight |= bit(end);
+    }
+    if (mv.flag() == PackedMove::EP_CAPTURE) {
+        occ ^= bit(turn ? end - 8 : end + 8);
+    } else if (mv.flag() == PackedMove::KING_CASTLE) {
+        occ ^= bit(start + 3) | bit(start + 1);
+        straight ^= bit(start + 3) | bit(start + 1);
+    } else if (mv.flag() == PackedMove::QUEEN_CASTLE) {
+        occ ^= bit(start - 4) | bit(start - 1);
+        straight ^= bit(start - 4) | bit(start - 1);
+    }
+    if ((landed == KNIGHT && (KNIGHT_ATTACKS[end] & bit(ksq))) ||
+        (landed == PAWN && (PAWN_ATTACKS[turn][end] & bit(ksq)))) {
+        return true;
+    }
+    return (bishop_attacks(ksq, occ) & diagonal) || (rook_attacks(ksq, occ) & straight);
+}
+
+// What SEE counts the pieces as; the king is worth more than anything it
+// could win
+const int SEE_VALUES[7] = {100, 320, 330, 500, 900, 20000, 0};
+
+/// My cheapest piece among the attackers, setting its type; NO_SQUARE if none
+uint Board::Impl::least_valuable(const bitboard attackers, const bool white, uint *type) const {
+    for (uint t = PAWN; t <= KING; ++t) {
+        bitboard bb = attackers & pieces[white][t];
+        if (bb) {
+            *type = t;
+            return lsb(bb);
+        }
+    }
+    return NO_SQUARE;
+}
+
+/// The sliders on lines into the square through occ. Once an attacker is
+/// lifted off occ, any piece that was lined up behind it shows up here.
+bitboard Board::Impl::xrays(const uint square, const bitboard occ) const {
+    bitboard diagonal = pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    bitboard straight = pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    return (bishop_attacks(square, occ) & diagonal) | (rook_attacks(square, occ) & straight);
+}
+
+/// Static exchange evaluation: what the move wins, in SEE_VALUES, if both
+/// sides then keep capturing on its end square with their cheapest piece for
+/// as long as it pays, without making any moves. Pieces lined up behind the
+/// ones that capture join in as the way clears. Pins are ignored, and so are
+/// promotions by the recaptures.
+int Board::Impl::see(const PackedMove mv) const {
+    if (mv.is_castle()) {
+        return 0;
+    }
+    uint start = mv.start();
+    uint end = mv.end();
+    bool side = color_of(squares[start]);
+    bitboard occ = (occupied[WHITE] | occupied[BLACK]) ^ bit(start);
+    int gain[32];
+    gain[0] = SEE_VALUES[type_of(squares[end])];
+    uint on_square = type_of(squares[start]);
+    if (mv.flag() == PackedMove::EP_CAPTURE) {
+        gain[0] = SEE_VALUES[PAWN];
+        occ ^= bit(side == WHITE ? end - 8 : end + 8);
+    } else if (mv.is_promotion()) {
+        gain[0] += SEE_VALUES[mv.promotion()] - SEE_VALUES[PAWN];
+        on_square = mv.promotion();
+    }
+    bitboard attackers = attackers_to(end, occ) & occ;
+    int depth = 0;
+    while (depth < 31) {
+        side = !side;
+        uint type;
+        uint from = least_valuable(attackers & occupied[side], side, &type);
+        if (from == NO_SQUARE) {
+            break;
+        }
+        // A king can only take if nothing is left to take it back
+        if (type == KING && (attackers & occupied[!side])) {
+            break;
+        }
+        ++depth;
+        gain[depth] = SEE_VALUES[on_square] - gain[depth - 1];
+        on_square = type;
+        occ ^= bit(from);
+        attackers = (attackers | xrays(end, occ)) & occ;
+    }
+    // Each side can stop taking whenever carrying on is worse
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        --depth;
+    }
+    return gain[0];
+}
+
+/// Does the move win at least threshold by see? Quicker than working out see
+/// in full, since it can stop as soon as the answer is clear either way.
+bool Board::Impl::see_ge(const PackedMove mv, const int threshold) const {
+    if (mv.is_castle()) {
+        return 0 >= threshold;
+    }
+    uint start = mv.start();
+    uint end = mv.end();
+    bool side = color_of(squares[start]);
+    bitboard occ = (occupied[WHITE] | occupied[BLACK]) ^ bit(start);
+    int captured = SEE_VALUES[type_of(squares[end])];
+    uint moved = type_of(squares[start]);
+    if (mv.flag() == PackedMove::EP_CAPTURE) {
+        captured = SEE_VALUES[PAWN];
+        occ ^= bit(side == WHITE ? end - 8 : end + 8);
+    } else if (mv.is_promotion()) {
+        captured += SEE_VALUES[mv.promotion()] - SEE_VALUES[PAWN];
+        moved = mv.promotion();
+    }
+    // How far above the threshold we'd be if the exchange stopped now, from
+    // the point of view of whoever just moved
+    int swap = captured - threshold;
+    if (swap < 0) {
+        return false;
+    }
+    swap = SEE_VALUES[moved] - swap;
+    if (swap <= 0) {
+        return true;
+    }
+    bitboard attackers = attackers_to(end, occ) & occ;
+    bool mover = side;
+    // Whether the move comes out at threshold if the last capture stands
+    bool ans = true;
+    while (true) {
+        side = !side;
+        attackers &= occ;
+        uint type;
+        uint from = least_valuable(attackers & occupied[side], side, &type);
+        if (from == NO_SQUARE) {
+            break;
+        }
+        if (type == KING) {
+            // Only if the other side has nothing left to take back with
+            return (attackers & occupied[!side]) ? ans : side == mover;
+        }
+        ans = side == mover;
+        // Side is ahead even if this piece is taken back, so the exchange is settled
+        swap = SEE_VALUES[type] - swap;
+        if (swap < (int)ans) {
+            break;
+        }
+        occ ^= bit(from);
+        attackers |= xrays(end, occ);
+    }
+    return ans;
+}
+
+/// Take back the last move made, which must be mv
+void Board::Impl::unmake_move(const PackedMove mv, const UndoInfo &undo) {
+    PROFILE_SCOPE(PROFILE_UNMAKE_MOVE);
+    turn = !turn;
+    past_states.pop_back();
+    if (augmoves.size() == moves.size()) {
+        augmoves.pop_back();
+    }
+    moves.pop_back();
+    uint8_t mov = mv.is_promotion() ? make_piece(turn, PAWN) : squares[mv.end()];
+    retract_move(mv, undo.captured, mov);
+    castling = undo.castling;
+    ep_square = undo.ep_square;
+    key = undo.hash;
+    halfmove = undo.halfmove;
+}
+
+/// Plays the given move, recording it in the human-readable move string
+void Board::Impl::play_move(const PackedMove mv){
+#ifndef NDEBUG
     // assert is a legal move
-    assert(is_in_list_of_moves(get_legal_moves(turn), mv));
+    MoveList legal;
+    get_legal_moves(turn, legal);
+    assert(is_in_list_of_moves(legal, mv));
+#endif
     // assert is my turn
-    assert((get_square(mv.start) < 'a') == turn);
-    if(turn) {
-        augmoves += "\n" + std::to_string(moves.size() / 2 + 1) + ". ";
-    }
+    assert(color_of(squares[mv.start()]) == turn);
     std::string augmv = "";
-    char capt; char mov;
-    // If its a castle, the rook also moves
-    if (mv.start == "e1" && !white_castle[1]) {
-        if (mv.end == "c1") {
-            execute_move({"a1","d1"}, &capt, &mov);
-            augmv += "O-O-O";
-        } else if (mv.end == "g1") {
-            execute_move({"h1","f1"}, &capt, &mov);
-            augmv += "O-O";
-        }
-    } else if (mv.start == "e8" && !black_castle[1]) {
-        if (mv.end == "c8") {
-            execute_move({"a8","d8"}, &capt, &mov);
-            augmv += "O-O-O";
-        } else if (mv.end == "g8") {
-            execute_move({"h8","f8"}, &capt, &mov);
-            augmv += "O-O";
-        }
-    }
-    // Record the move
-    moves.push_back(mv);
-    // Execute it
-    execute_move(mv, &capt, &mov);
-    // If a rook or king moved, update castling states appropriately
-    if (mv.start == "a1") {
-        white_castle[0] = true;
-    } else if (mv.start == "e1") {
-        white_castle[1] = true;
-    } else if (mv.start == "h1") {
-        white_castle[2] = true;
-    } else if (mv.start == "a8") {
-        black_castle[0] = true;
-    } else if (mv.start == "e8") {
-        black_castle[1] = true;
-    } else if (mv.start == "h8") {
-        black_castle[2] = true;
-    }
-    // If the king moves, update white_king of black_king
-    if (mov == 'k') {
-        black_king = mv.end;
-    }
-    if (mov == 'K') {
-        white_king = mv.end;
+    if(turn) {
+        augmv += "\n" + std::to_string(moves.size() / 2 + 1) + ". ";
     }
+    uint8_t mov = squares[mv.start()];
+    bool capt = mv.is_capture();
     // Record the Augmented (human-readable) move
-    if (augmv.size() == 0){
-        if (mov == 'P' || mov == 'p'){
-            if (capt != ' ') {
-                augmv = mv.start.substr(0,1) + "x" + mv.end;     // Like exd5
-            } else {
-                augmv = mv.end;                         // Like d5
-            }
+    Move str = to_move(mv);
+    if (mv.flag() == PackedMove::QUEEN_CASTLE) {
+        augmv += "O-O-O";
+    } else if (mv.flag() == PackedMove::KING_CASTLE) {
+        augmv += "O-O";
+    } else if (type_of(mov) == PAWN){
+        if (capt) {
+            augmv += str.start.substr(0,1) + "x" + str.end;    // Like exd5
         } else {
-            if (capt != ' ') {
-                augmv = upper(mov) + mv.end;            // Like Nc3
-            } else {
-                augmv = upper(mov) + "x" + mv.end;      // Like Nxd5
-            }
+            augmv += str.end;                                   // Like d5
+        }
+    } else {
+        if (capt) {
+            augmv += upper(to_char(mov)) + str.end;             // Like Nc3
+        } else {
+            augmv += upper(to_char(mov)) + "x" + str.end;       // Like Nxd5
         }
-    } if (am_in_check(!turn)) {
-        if (get_legal_moves(!turn).size() == 0) {
+    }
+    make_move(mv);
+    if (am_in_check(turn)) {
+        MoveList replies;
+        get_legal_moves(turn, replies);
+        if (replies.empty()) {
             augmv += "# ";
         } else {
             augmv += "+ ";
         }
     }
-    augmoves += augmv;
-    // Add this board state to the bank of previous board states
-    past_states.push_back(to_string());
-    // Increment whose turn it is now
-    turn = !turn;
+    augmoves.push_back(augmv);
 }
 
 // Returns the string of human-readable moves
 std::string Board::Impl::move_string() const {
-    return augmoves;
+    std::string ans = "";
+    for (const std::string &augmv : augmoves) {
+        ans += augmv;
+    }
+    return ans;
+}
+
+// Can the side to move do anything at all?
+bool Board::Impl::has_legal_moves() {
+    MoveList ans;
+    get_legal_moves(turn, ans);
+    return !ans.empty();
 }
 
-// Returns true if the player has no moves
+// Returns true if the player has no moves, or the game is drawn by repetition
+// or the fifty move rule. The draws are cheap, so they go first.
 bool Board::Impl::game_over() {
-    return get_legal_moves(turn).size() == 0 || threefold_rep(past_states.back());
+    return threefold_rep() || fifty_moves() || !has_legal_moves();
 }
 
-// Returns true if the game is over, black is in check, and it is black's turn
+// Returns true if black is checkmated: it is black's turn, black is in check and has no moves
 bool Board::Impl::white_wins() {
-    return !turn && game_over() && am_in_check(false) && !threefold_rep(past_states.back());
+    return !turn && am_in_check(false) && !has_legal_moves();
 }
 
-// Returns true if the game is over, white is in check, and it is white's turn
+// Returns true if white is checkmated: it is white's turn, white is in check and has no moves
 bool Board::Impl::black_wins() {
-    return turn && game_over() && am_in_check(true) && !threefold_rep(past_states.back());
+    return turn && am_in_check(true) && !has_legal_moves();
 }
 
 bool Board::Impl::is_white_turn() const {
@@ -735,19 +1029,325 @@ bool Board::Impl::is_white_turn() const {
 
 // Converts the board to a 64-long string
 std::string Board::Impl::to_string() const {
-    return std::string(b.begin(), b.end());
+    std::string ans(64, ' ');
+    for (uint i = 0; i < 64; ++i) {
+        ans[i] = to_char(squares[i]);
+    }
+    return ans;
+}
+
+bool Board::Impl::in_check() const {
+    return am_in_check(turn);
+}
+
+// Returns true if the current position has been seen before, for a search
+// that scores the first repetition as a draw rather than wait for the third
+bool Board::Impl::repeated() const {
+    int last = past_states.size() - 1;
+    int oldest = std::max(0, last - (int)halfmove);
+    for (int i = last - 4; i >= oldest; i -= 2) {
+        if (past_states[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if the current position has been seen at least twice before.
+// Nothing from before the last capture or pawn move can come back, and the
+// same side has to be on move, so only every other key since then is checked.
+bool Board::Impl::threefold_rep() const {
+    PROFILE_SCOPE(PROFILE_THREEFOLD_REP);
+    int last = past_states.size() - 1;
+    int oldest = std::max(0, last - (int)halfmove);
+    int seen = 0;
+    for (int i = last - 4; i >= oldest; i -= 2) {
+        if (past_states[i] == key && ++seen == 2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if fifty moves each have gone by without a capture or pawn move
+bool Board::Impl::fifty_moves() const {
+    return halfmove >= 100;
 }
 
-// Returns true if the state given has been repeated at least 3 times
-bool Board::Impl::threefold_rep(const std::string last) const {
-    return std::count(past_states.begin(), past_states.end(), last) >= 3;
+// The en passant part of the key. Only counted when the side to move has a pawn
+// that could actually take, so positions that only differ by a useless en
+// passant square still hash (and repeat) the same.
+uint64_t Board::Impl::ep_key() const {
+    if (ep_square == NO_SQUARE ||
+        !(PAWN_ATTACKS[!turn][ep_square] & pieces[turn][PAWN])) {
+        return 0;
+    }
+    return ZOBRIST.ep_file[ep_square % 8];
+}
+
+// Works the key out from nothing. make_move keeps it up to date, this is for
+// when the board is set up some other way.
+uint64_t Board::Impl::compute_key() const {
+    uint64_t ans = 0;
+    for (uint i = 0; i < 64; ++i) {
+        if (squares[i] != EMPTY) {
+            ans ^= ZOBRIST.pieces[squares[i]][i];
+        }
+    }
+    ans ^= ZOBRIST.castling[castling] ^ ep_key();
+    if (!turn) {
+        ans ^= ZOBRIST.black_to_move;
+    }
+    return ans;
 }
 
-// Sets the internal board state to the one given
+// Sets the internal board state to the one given, rebuilding the bitboards from it
 void Board::Impl::set_board(const board_array &new_b) {
-    for(char i = 0; i < 64; ++i){
-        b[i] = new_b[i];
+    std::fill(&pieces[0][0], &pieces[0][0] + 12, 0);
+    occupied[WHITE] = occupied[BLACK] = 0;
+    squares.fill(EMPTY);
+    ep_square = NO_SQUARE;
+    halfmove = 0;
+    key = 0;
+    for(uint i = 0; i < 64; ++i){
+        uint8_t piece = to_piece(new_b[i]);
+        if (piece != EMPTY) {
+            put_piece(i, piece);
+        }
+    }
+    // Only keep the castles whose king and rook are still at home
+    for (uint sq : {A1, E1, H1, A8, E8, H8}) {
+        if (squares[sq] != to_piece(START_BOARD[sq])) {
+            castling &= CASTLE_MASKS[sq];
+        }
+    }
+    key = compute_key();
+    // Repetitions count from here
+    past_states.assign(1, key);
+}
+
+// Sets up the position from Forsyth-Edwards Notation, like
+// "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1". The move
+// counters may be left off. The game starts over from the new position.
+// Returns false, leaving the board alone, if the FEN doesn't make sense.
+bool Board::Impl::set_fen(const std::string &fen) {
+    std::istringstream in(fen);
+    std::string layout, side, castles = "-", ep = "-";
+    uint half = 0, full = 1;
+    in >> layout >> side >> castles >> ep;
+    if (!(in >> half)) half = 0;
+    if (!(in >> full) || full == 0) full = 1;
+
+    board_array new_b;
+    new_b.fill(' ');
+    int rank = 7, file = 0;
+    for (char c : layout) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) return false;
+        } else if (to_piece(c) != EMPTY && file < 8) {
+            new_b[rank * 8 + file++] = c;
+        } else {
+            return false;
+        }
+    }
+    if (rank != 0 || file != 8 || (side != "w" && side != "b")) {
+        return false;
+    }
+    uint new_castling = 0;
+    if (castles != "-") {
+        for (char c : castles) {
+            switch (c) {
+                case 'K': new_castling |= WHITE_OO; break;
+                case 'Q': new_castling |= WHITE_OOO; break;
+                case 'k': new_castling |= BLACK_OO; break;
+                case 'q': new_castling |= BLACK_OOO; break;
+                default: return false;
+            }
+        }
+    }
+    uint new_ep = NO_SQUARE;
+    if (ep != "-") {
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || (ep[1] != '3' && ep[1] != '6')) {
+            return false;
+        }
+        new_ep = to_index(ep);
+    }
+
+    turn = side == "w";
+    castling = new_castling;
+    set_board(new_b);
+    ep_square = new_ep;
+    halfmove = half;
+    key = compute_key();
+    moves.clear();
+    augmoves.clear();
+    past_states.assign(1, key);
+    first_ply = 2 * (full - 1) + !turn;
+    return true;
+}
+
+// Writes the position out as FEN
+std::string Board::Impl::fen() const {
+    std::string ans;
+    for (int rank = 7; rank >= 0; --rank) {
+        int gap = 0;
+        for (int file = 0; file < 8; ++file) {
+            uint8_t piece = squares[rank * 8 + file];
+            if (piece == EMPTY) {
+                ++gap;
+                continue;
+            }
+            if (gap) {
+                ans += '0' + gap;
+                gap = 0;
+            }
+            ans += to_char(piece);
+        }
+        if (gap) {
+            ans += '0' + gap;
+        }
+        if (rank) {
+            ans += '/';
+        }
+    }
+    ans += turn ? " w " : " b ";
+    if (castling & WHITE_OO) ans += 'K';
+    if (castling & WHITE_OOO) ans += 'Q';
+    if (castling & BLACK_OO) ans += 'k';
+    if (castling & BLACK_OOO) ans += 'q';
+    if (!castling) ans += '-';
+    ans += ' ';
+    ans += ep_square == NO_SQUARE ? "-" : to_square(ep_square);
+    ans += " " + std::to_string(halfmove) + " " + std::to_string((first_ply + moves.size()) / 2 + 1);
+    return ans;
+}
+
+// Standard Algebraic Notation for a legal move, like "Nbd7", "exd6", "e8=Q+"
+// or "O-O-O#". The file or rank of the start square is only given when
+// another piece of the same kind could also go there.
+std::string Board::Impl::san(const PackedMove mv) {
+    std::string ans;
+    uint8_t piece = squares[mv.start()];
+    if (mv.flag() == PackedMove::KING_CASTLE) {
+        ans = "O-O";
+    } else if (mv.flag() == PackedMove::QUEEN_CASTLE) {
+        ans = "O-O-O";
+    } else {
+        if (type_of(piece) != PAWN) {
+            ans += PIECE_CHARS[type_of(piece)];
+            MoveList legal;
+            get_legal_moves(turn, legal);
+            bool clash = false, same_file = false, same_rank = false;
+            for (const PackedMove &other : legal) {
+                if (other.end() == mv.end() && other.start() != mv.start() && squares[other.start()] == piece) {
+                    clash = true;
+                    same_file |= other.start() % 8 == mv.start() % 8;
+                    same_rank |= other.start() / 8 == mv.start() / 8;
+                }
+            }
+            if (clash && (!same_file || same_rank)) {
+                ans += FILES[mv.start() % 8];
+            }
+            if (same_file) {
+                ans += '1' + mv.start() / 8;
+            }
+        } else if (mv.is_capture()) {
+            ans += FILES[mv.start() % 8];
+        }
+        if (mv.is_capture()) {
+            ans += 'x';
+        }
+        ans += to_square(mv.end());
+        if (mv.is_promotion()) {
+            ans += '=';
+            ans += PIECE_CHARS[mv.promotion()];
+        }
+    }
+    UndoInfo undo = make_move(mv);
+    if (am_in_check(turn)) {
+        ans += has_legal_moves() ? "+" : "#";
+    }
+    unmake_move(mv, undo);
+    return ans;
+}
+
+// Reads a move in Standard Algebraic Notation. Check marks and annotations
+// ("+", "#", "!", "?") are ignored, extra disambiguation is allowed, and
+// castles may be written with zeros. Coordinates like "e2e4" or "e7e8q" work
+// too. Returns the null move if no legal move fits, or more than one does.
+PackedMove Board::Impl::parse_san(const std::string &text) {
+    std::string s = text;
+    while (!s.empty() && std::string("+#!?").find(s.back()) != std::string::npos) {
+        s.pop_back();
+    }
+    std::replace(s.begin(), s.end(), '0', 'O');
+    MoveList legal;
+    get_legal_moves(turn, legal);
+    if (s == "O-O" || s == "O-O-O") {
+        uint flag = s == "O-O" ? PackedMove::KING_CASTLE : PackedMove::QUEEN_CASTLE;
+        for (const PackedMove &m : legal) {
+            if (m.flag() == flag) {
+                return m;
+            }
+        }
+        return PackedMove{};
+    }
+
+    int type = PAWN;
+    bool piece_given = !s.empty() && std::string("NBRQK").find(s[0]) != std::string::npos;
+    if (piece_given) {
+        type = type_of(to_piece(s[0]));
+        s.erase(0, 1);
+    }
+    // A promotion ends in a piece letter, with or without the '='
+    int promotion = 0;
+    if (s.size() > 2 && !std::isdigit((unsigned char)s.back())) {
+        promotion = type_of(to_piece(std::toupper((unsigned char)s.back())));
+        s.pop_back();
+        if (!s.empty() && s.back() == '=') {
+            s.pop_back();
+        }
+        if (promotion < KNIGHT || promotion > QUEEN) {
+            return PackedMove{};
+        }
+    }
+    if (s.size() < 2 || s[s.size() - 2] < 'a' || s[s.size() - 2] > 'h' || s.back() < '1' || s.back() > '8') {
+        return PackedMove{};
+    }
+    uint end = to_index(s.substr(s.size() - 2));
+    // Whatever is left says where the piece came from
+    int from_file = -1, from_rank = -1;
+    for (size_t i = 0; i + 2 < s.size(); ++i) {
+        if (s[i] >= 'a' && s[i] <= 'h') {
+            from_file = s[i] - 'a';
+        } else if (s[i] >= '1' && s[i] <= '8') {
+            from_rank = s[i] - '1';
+        } else if (s[i] != 'x' && s[i] != '-') {
+            return PackedMove{};
+        }
     }
+
+    // Coordinates name the start square and not the piece
+    bool any_piece = !piece_given && from_file >= 0 && from_rank >= 0;
+    PackedMove ans{};
+    for (const PackedMove &m : legal) {
+        if (m.end() != end || (!any_piece && type_of(squares[m.start()]) != type) ||
+            (from_file >= 0 && (int)(m.start() % 8) != from_file) ||
+            (from_rank >= 0 && (int)(m.start() / 8) != from_rank) ||
+            (promotion ? !m.is_promotion() || m.promotion() != promotion : m.is_promotion())) {
+            continue;
+        }
+        if (!ans.is_null()) {
+            return PackedMove{};
+        }
+        ans = m;
+    }
+    return ans;
 }
 
 Board::Board() : 
@@ -760,14 +1360,40 @@ I(std::make_unique<Impl>())
     I->set_board(b); 
 }
 
+Board::Board(std::unique_ptr<Impl> impl) :
+I(std::move(impl))
+{}
+
 Board::~Board(){}
 
+// Copies the whole Impl, history and all, in one go
+std::unique_ptr<Board> Board::clone() const{
+    return std::unique_ptr<Board>(new Board(std::make_unique<Impl>(*I)));
+}
+
 void Board::play_move(Move mv){
+    I->play_move(I->to_packed(mv));
+}
+
+void Board::play_move(PackedMove mv){
     I->play_move(mv);
 }
 
+UndoInfo Board::make_move(PackedMove mv){
+    return I->make_move(mv);
+}
+
+void Board::unmake_move(PackedMove mv, const UndoInfo &undo){
+    I->unmake_move(mv, undo);
+}
+
 std::vector<Move> Board::get_past_moves() const{
-    return I->get_past_moves();
+    auto packed = I->get_past_moves();
+    std::vector<Move> ans(0);
+    for (const PackedMove &m : packed) {
+        ans.push_back(I->to_move(m));
+    }
+    return ans;
 }
 
 board_array Board::get_board() const{
@@ -775,7 +1401,33 @@ board_array Board::get_board() const{
 }
 
 std::vector<Move> Board::get_legal_moves(const bool amWhite) const{
-    return I->get_legal_moves(amWhite);
+    MoveList packed;
+    I->get_legal_moves(amWhite, packed);
+    std::vector<Move> ans(0);
+    for (const PackedMove &m : packed) {
+        ans.push_back(I->to_move(m));
+    }
+    return ans;
+}
+
+void Board::get_legal_moves(const bool amWhite, MoveList &moves) const{
+    moves.clear();
+    I->get_legal_moves(amWhite, moves);
+}
+
+void Board::get_captures(const bool am_white, MoveList &moves) const{
+    moves.clear();
+    I->get_captures(am_white, moves);
+}
+
+std::vector<Move> Board::get_moves(const bool am_white) const{
+    MoveList packed;
+    I->get_moves(am_white, packed);
+    std::vector<Move> ans(0);
+    for (const PackedMove &m : packed) {
+        ans.push_back(I->to_move(m));
+    }
+    return ans;
 }
 
 std::string Board::to_string() const{
@@ -802,15 +1454,99 @@ bool Board::is_white_turn() const{
     return I->is_white_turn();
 }
 
+uint64_t Board::hash() const{
+    return I->key;
+}
+
+uint Board::halfmove_clock() const{
+    return I->halfmove;
+}
+
+uint64_t Board::pieces(const bool white, const uint type) const{
+    return I->pieces[white][type];
+}
+
+uint Board::piece_type(const uint square) const{
+    return type_of(I->squares[square]);
+}
+
+bool Board::in_check() const{
+    return I->in_check();
+}
+
+bool Board::is_repetition() const{
+    return I->repeated();
+}
+
+uint64_t Board::key_after(PackedMove mv) const{
+    return I->key_after(mv);
+}
+
+bool Board::gives_check(PackedMove mv) const{
+    return I->gives_check(mv);
+}
+
+int Board::see(PackedMove mv) const{
+    return I->see(mv);
+}
+
+bool Board::see_ge(PackedMove mv, const int threshold) const{
+    return I->see_ge(mv, threshold);
+}
+
 char Board::get_square(std::string square) const{
     return I->get_square(square);
 }
 
-// Reset by simply throwing out the old board and getting a new one
+bool Board::is_square_attacked(std::string square, const bool by_white) const{
+    return I->is_square_attacked(to_index(square), by_white);
+}
+
+bool Board::is_square_attacked(const uint square, const bool by_white) const{
+    return I->is_square_attacked(square, by_white);
+}
+
+// Reset in place, so the board keeps its history buffers
 void Board::reset(){
-    I = std::make_unique<Impl>();
+    I->reset();
 }
 
 void Board::set_board(const board_array &b){
     I->set_board(b);
 }
+
+bool Board::set_fen(const std::string &fen){
+    return I->set_fen(fen);
+}
+
+std::string Board::fen() const{
+    return I->fen();
+}
+
+std::string Board::san(PackedMove mv) const{
+    return I->san(mv);
+}
+
+PackedMove Board::parse_san(const std::string &text) const{
+    return I->parse_san(text);
+}
+
+Move Board::to_move(PackedMove mv) const{
+    return I->to_move(mv);
+}
+
+PackedMove Board::to_packed(const Move &mv) const{
+    return I->to_packed(mv);
+}
+
+Profile_Stats Board::profile_stats(){
+    return ::profile_stats();
+}
+
+void Board::reset_profile_stats(){
+    ::reset_profile_stats();
+}
+
+bool Board::check_magics(){
+    return ::check_magics();
+}
@@ -2,14 +2,83 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <cstdint>
 
 #pragma once
 
+#include "profile.hh"
+
 struct Move {
     std::string start;
     std::string end;
 };
 
+// A move packed into 16 bits: start square in bits 0-5, end square in bits 6-11
+// and a 4 bit flag on top. Promotions set bit 3 of the flag and keep the piece
+// in the low two bits, captures set bit 2. This is what the move generator
+// works with; Move is only built when a caller asks for strings.
+struct PackedMove {
+    enum FLAG {
+        QUIET = 0, DOUBLE_PUSH = 1, KING_CASTLE = 2, QUEEN_CASTLE = 3,
+        CAPTURE = 4, EP_CAPTURE = 5,
+        PROMOTION = 8, PROMO_N = 8, PROMO_B = 9, PROMO_R = 10, PROMO_Q = 11,
+        PROMO_CAPTURE = 12
+    };
+
+    uint16_t data;
+
+    // Left uninitialised so MoveList doesn't pay to clear 256 of them;
+    // PackedMove{} is the null move
+    PackedMove() = default;
+    PackedMove(const uint start, const uint end, const uint flag = QUIET) :
+        data(start | (end << 6) | (flag << 12)) {}
+
+    uint start() const { return data & 63; }
+    uint end() const { return (data >> 6) & 63; }
+    uint flag() const { return data >> 12; }
+    bool is_capture() const { return flag() & CAPTURE; }
+    bool is_promotion() const { return flag() & PROMOTION; }
+    bool is_castle() const { return flag() == KING_CASTLE || flag() == QUEEN_CASTLE; }
+    // Piece type promoted to (KNIGHT..QUEEN in bitboard.hh order)
+    int promotion() const { return (flag() & 3) + 1; }
+    // The null move, used for "no move yet"
+    bool is_null() const { return data == 0; }
+
+    bool operator==(const PackedMove &o) const { return data == o.data; }
+    bool operator!=(const PackedMove &o) const { return data != o.data; }
+};
+
+// Fixed capacity list of moves that lives on the stack, so generating moves
+// never touches the allocator. No legal position has more than 218 moves.
+class MoveList {
+    private:
+        PackedMove moves[256];
+        uint count;
+    public:
+        MoveList() : count(0) {}
+
+        void push_back(const PackedMove m) { moves[count++] = m; }
+        void clear() { count = 0; }
+        uint size() const { return count; }
+        bool empty() const { return count == 0; }
+        PackedMove &operator[](const uint i) { return moves[i]; }
+        const PackedMove &operator[](const uint i) const { return moves[i]; }
+        PackedMove *begin() { return moves; }
+        PackedMove *end() { return moves + count; }
+        const PackedMove *begin() const { return moves; }
+        const PackedMove *end() const { return moves + count; }
+};
+
+// Everything make_move changes that can't be worked out again from the move
+// itself. Hand it back to unmake_move to restore the position exactly.
+struct UndoInfo {
+    uint64_t hash;          // Zobrist key before the move
+    uint8_t captured;       // Piece taken (including en passant), EMPTY if none
+    uint8_t castling;       // Castling rights before the move
+    uint8_t ep_square;      // En passant square before the move
+    uint16_t halfmove;      // Halfmove clock before the move
+};
+
 typedef std::array<char, 64> board_array;
 
 const uint to_index(const std::string square);
@@ -18,6 +87,7 @@ class Board{
     private:
         class Impl;
         std::unique_ptr<Impl> I;
+        Board(std::unique_ptr<Impl> impl);
     public:
         Board();
         Board(const board_array &b);
@@ -26,11 +96,22 @@ class Board{
         // Disallow cache copies, to simplify memory management.
         Board(const Board&) = delete;
         Board& operator=(const Board&) = delete;
+        // An independent board in the same position with the same history,
+        // for handing to another thread
+        std::unique_ptr<Board> clone() const;
 
         void play_move(Move mv);
+        void play_move(PackedMove mv);
+        // Fast path for searching: no legality check and no move string.
+        // unmake_move must be given the same move and the UndoInfo it returned.
+        UndoInfo make_move(PackedMove mv);
+        void unmake_move(PackedMove mv, const UndoInfo &undo);
         std::vector<Move> get_past_moves() const;
         board_array get_board() const;
         std::vector<Move> get_legal_moves(const bool amWhite) const;
+        void get_legal_moves(const bool amWhite, MoveList &moves) const;
+        // Just the legal captures (en passant too) and promotions
+        void get_captures(const bool am_white, MoveList &moves) const;
         std::vector<Move> get_moves(const bool am_white) const;
         std::string to_string() const;
         std::string move_string() const;
@@ -38,7 +119,61 @@ class Board{
         bool white_wins() const;
         bool black_wins() const;
         bool is_white_turn() const;
+        // Zobrist key of the position: pieces, side to move, castling rights
+        // and en passant file. Equal positions have equal keys.
+        uint64_t hash() const;
+        // The hash() the position would have after the move, without making it
+        uint64_t key_after(PackedMove mv) const;
+        // Would the move put the other side in check? Nothing is moved.
+        bool gives_check(PackedMove mv) const;
+        // Static exchange evaluation: the material the move wins (negative if
+        // it loses some), in centipawns, if both sides then keep taking on its
+        // end square with their cheapest piece while it pays. Nothing is moved.
+        int see(PackedMove mv) const;
+        // Whether see(mv) >= threshold, usually without working out see in full
+        bool see_ge(PackedMove mv, const int threshold) const;
+        // Plies since the last capture or pawn move; the game is drawn at 100
+        uint halfmove_clock() const;
+        // Squares holding one side's pieces of a type, and the type of piece on
+        // a square; types are 0-5 for pawn, knight, bishop, rook, queen and king
+        // (the PIECE order in bitboard.hh) and 6 is an empty square
+        uint64_t pieces(const bool white, const uint type) const;
+        uint piece_type(const uint square) const;
+        // Is the side to move in check
+        bool in_check() const;
+        // Has this position come up before since the last capture or pawn
+        // move? Searches score this as a draw without waiting for a third time.
+        bool is_repetition() const;
         char get_square(std::string square) const;
+        // Does by_white have a piece that could capture on the square (given as
+        // "e4" or as an index, a1 = 0)? Whether anything is there doesn't matter.
+        bool is_square_attacked(std::string square, const bool by_white) const;
+        bool is_square_attacked(const uint square, const bool by_white) const;
         void set_board(const board_array &b);
+        // Forsyth-Edwards Notation. set_fen starts the game over from the
+        // position, and returns false (changing nothing) if it can't read it.
+        bool set_fen(const std::string &fen);
+        std::string fen() const;
+        // Back to the starting position, keeping the memory the board already has
         void reset();
+
+        // Conversions between the string moves and the packed ones. Packing needs
+        // the position to tell captures, castles and en passant apart.
+        Move to_move(PackedMove mv) const;
+        PackedMove to_packed(const Move &mv) const;
+        // Standard Algebraic Notation ("Nbd7", "exd8=Q+", "O-O"), for legal
+        // moves in this position. parse_san gives the null move for anything
+        // that isn't exactly one legal move.
+        std::string san(PackedMove mv) const;
+        PackedMove parse_san(const std::string &text) const;
+
+        // Calls and cycles spent in legal_moves, make_move, unmake_move,
+        // castleing, execute_move and threefold_rep (and evaluation), across
+        // all threads.
+        // Only counted in builds with -DCHESS_PROFILE, otherwise all zero.
+        static Profile_Stats profile_stats();
+        static void reset_profile_stats();
+        // Checks the magic numbers behind the slider attack tables on every
+        // square, even on CPUs where pext is used instead of them
+        static bool check_magics();
 };
\ No newline at end of file
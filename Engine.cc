@@ -0,0 +1,26 @@
+#include "Engine.hh"
+#include "AlphaBetaEngine.hh"
+#include "RandomEngine.hh"
+
+Engine::Engine(Board& b, bool amWhite) : board(b), white(amWhite), limits{}, on_info() {}
+
+Engine::~Engine() {}
+
+// alphabeta-qchecks is alphabeta searching quiet checks for a ply into its
+// quiescence search, to compare the two on tactics
+const std::vector<std::string> ENGINE_NAMES = {"alphabeta", "alphabeta-qchecks", "random"};
+
+std::unique_ptr<Engine> make_engine(const std::string &name, Board &board, bool white) {
+    if (name == "alphabeta") {
+        return std::make_unique<AlphaBetaEngine>(board, white);
+    }
+    if (name == "alphabeta-qchecks") {
+        auto engine = std::make_unique<AlphaBetaEngine>(board, white);
+        engine->set_quiescence_checks(1);
+        return engine;
+    }
+    if (name == "random") {
+        return std::make_unique<RandomEngine>(board, white);
+    }
+    return nullptr;
+}
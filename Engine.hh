@@ -2,25 +2,68 @@
 #include <functional>
 #include <memory>
 #include <array>
+#include <vector>
 
 #pragma once
 
 #include "Board.hh"
 #include "evaluation.hh"
 
+// How far a search may go. Zero means no limit of that kind; engines pick
+// their own when there are no limits at all. time_ms is a fixed time for the
+// move; clock_ms is the time left on the engine's clock, for it to budget.
+struct Search_Limits {
+    int depth;
+    uint64_t nodes;
+    uint64_t time_ms;
+    uint64_t clock_ms;
+    uint64_t increment_ms;      // Added to the clock after each move
+    int moves_to_go;            // Until the next time control, 0 if none
+};
+
+// Progress reports from a search, handed to the info callback as it goes
+struct Search_Info {
+    int depth;              // Finished iterations
+    uint64_t nodes;         // Positions visited so far
+    double seconds;         // Since get_move was called
+    double score;           // For the engine's own side
+    PackedMove best;        // The move it would play now
+};
+
+typedef std::function<void(const Search_Info&)> info_fn;
+
 class Engine {
     protected:
         Board &board;
         bool white;
+        Search_Limits limits;
+        info_fn on_info;
     public:
         Engine(Board& board, bool amWhite);
-        ~Engine();
+        virtual ~Engine();
 
         // Disallow engine copies, to simplify memory management.
         Engine(const Engine&) = delete;
         Engine& operator=(const Engine&) = delete;
 
-        virtual Move get_move(Move opp_move)=0;
+        // Where the time went, see Board::profile_stats
+        static Profile_Stats stats() { return Board::profile_stats(); }
+
+        void set_limits(const Search_Limits &l) { limits = l; }
+        // Called with each progress report. Engines that don't search may
+        // never call it.
+        void set_info_callback(info_fn f) { on_info = f; }
+        // Transposition table size; engines without one ignore it
+        virtual void set_hash_size(const size_t) {}
+        // Positions visited by the last get_move
+        virtual uint64_t nodes() const { return 0; }
+
+        virtual PackedMove get_move(PackedMove opp_move)=0;
         virtual double evaluate()=0;
         virtual void process_result(const bool I_win, const bool opponent_wins)=0;
-};
\ No newline at end of file
+};
+
+// The engine called name, playing white or black on board, or nullptr if
+// there's no engine by that name. See ENGINE_NAMES.
+std::unique_ptr<Engine> make_engine(const std::string &name, Board &board, bool white);
+extern const std::vector<std::string> ENGINE_NAMES;
\ No newline at end of file
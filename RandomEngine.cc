@@ -0,0 +1,19 @@
+#include "RandomEngine.hh"
+
+// White and black get different streams from the same seed
+RandomEngine::RandomEngine(Board& b, bool amWhite, uint64_t seed) :
+    Engine(b, amWhite), rng(seed * 2 + amWhite) {}
+
+PackedMove RandomEngine::get_move(PackedMove) {
+    board.get_legal_moves(white, moves);
+    if (moves.size() == 0) {
+        return PackedMove{};
+    }
+    return moves[rng() % moves.size()];
+}
+
+double RandomEngine::evaluate() {
+    return 0;
+}
+
+void RandomEngine::process_result(const bool, const bool) {}
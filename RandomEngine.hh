@@ -0,0 +1,20 @@
+#include <random>
+
+#pragma once
+
+#include "Engine.hh"
+
+// Plays a uniformly random legal move. Seeded, so the same seed plays the same
+// games; mostly useful as a sparring partner and for timing the Board side of
+// a game without any search in the way.
+class RandomEngine : public Engine {
+    private:
+        std::mt19937_64 rng;
+        MoveList moves;
+    public:
+        RandomEngine(Board& board, bool amWhite, uint64_t seed=0);
+
+        PackedMove get_move(PackedMove opp_move) override;
+        double evaluate() override;
+        void process_result(const bool I_win, const bool opponent_wins) override;
+};
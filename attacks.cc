@@ -0,0 +1,124 @@
+#include "attacks.hh"
+
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+Magic BISHOP_MAGICS[64];
+Magic ROOK_MAGICS[64];
+bool USE_PEXT = false;
+
+// Every square's table, back to back. The sizes are the sum over the board of
+// 2^(bits in the mask), the most either index method can need.
+static bitboard BISHOP_TABLE[5248];
+static bitboard ROOK_TABLE[102400];
+
+// Found offline by trying sparse random numbers (the AND of three xorshift64*
+// outputs) until every occupancy of the square's mask landed on an index of
+// its own, or one shared with an occupancy that attacks the same squares.
+// Searching for them at start up takes tens of milliseconds, so they are kept.
+static const bitboard BISHOP_MAGIC_NUMBERS[64] = {
+    0x40106000A1160020ULL, 0x0020010250810120ULL, 0x2010010220280081ULL, 0x002806004050C040ULL,
+    0x0002021018000000ULL, 0x2001112010000400ULL, 0x0881010120218080ULL, 0x1030820110010500ULL,
+    0x0000120222042400ULL, 0x2000020404040044ULL, 0x8000480094208000ULL, 0x0003422A02000001ULL,
+    0x000A220210100040ULL, 0x8004820202226000ULL, 0x0018234854100800ULL, 0x0100004042101040ULL,
+    0x0004001004082820ULL, 0x0010000810010048ULL, 0x1014004208081300ULL, 0x2080818802044202ULL,
+    0x0040880C00A00100ULL, 0x0080400200522010ULL, 0x0001000188180B04ULL, 0x0080249202020204ULL,
+    0x1004400004100410ULL, 0x00013100A0022206ULL, 0x2148500001040080ULL, 0x4241080011004300ULL,
+    0x4020848004002000ULL, 0x10101380D1004100ULL, 0x0008004422020284ULL, 0x01010A1041008080ULL,
+    0x0808080400082121ULL, 0x0808080400082121ULL, 0x0091128200100C00ULL, 0x0202200802010104ULL,
+    0x8C0A020200440085ULL, 0x01A0008080B10040ULL, 0x0889520080122800ULL, 0x100902022202010AULL,
+    0x04081A0816002000ULL, 0x0000681208005000ULL, 0x8170840041008802ULL, 0x0A00004200810805ULL,
+    0x0830404408210100ULL, 0x2602208106006102ULL, 0x1048300680802628ULL, 0x2602208106006102ULL,
+    0x0602010120110040ULL, 0x0941010801043000ULL, 0x000040440A210428ULL, 0x0008240020880021ULL,
+    0x0400002012048200ULL, 0x00AC102001210220ULL, 0x0220021002009900ULL, 0x84440C080A013080ULL,
+    0x0001008044200440ULL, 0x0004C04410841000ULL, 0x2000500104011130ULL, 0x1A0C010011C20229ULL,
+    0x0044800112202200ULL, 0x0434804908100424ULL, 0x0300404822C08200ULL, 0x48081010008A2A80ULL
+};
+
+static const bitboard ROOK_MAGIC_NUMBERS[64] = {
+    0x0A80004000801220ULL, 0x8040004010002008ULL, 0x2080200010008008ULL, 0x1100100008210004ULL,
+    0xC200209084020008ULL, 0x2100010004000208ULL, 0x0400081000822421ULL, 0x0200010422048844ULL,
+    0x0800800080400024ULL, 0x0001402000401000ULL, 0x3000801000802001ULL, 0x4400800800100083ULL,
+    0x0904802402480080ULL, 0x4040800400020080ULL, 0x0018808042000100ULL, 0x4040800080004100ULL,
+    0x0040048001458024ULL, 0x00A0004000205000ULL, 0x3100808010002000ULL, 0x4825010010000820ULL,
+    0x5004808008000401ULL, 0x2024818004000A00ULL, 0x0005808002000100ULL, 0x2100060004806104ULL,
+    0x0080400880008421ULL, 0x4062220600410280ULL, 0x010A004A00108022ULL, 0x0000100080080080ULL,
+    0x0021000500080010ULL, 0x0044000202001008ULL, 0x0000100400080102ULL, 0xC020128200040545ULL,
+    0x0080002000400040ULL, 0x0000804000802004ULL, 0x0000120022004080ULL, 0x010A386103001001ULL,
+    0x9010080080800400ULL, 0x8440020080800400ULL, 0x0004228824001001ULL, 0x000000490A000084ULL,
+    0x0080002000504000ULL, 0x200020005000C000ULL, 0x0012088020420010ULL, 0x0010010080080800ULL,
+    0x0085001008010004ULL, 0x0002000204008080ULL, 0x0040413002040008ULL, 0x0000304081020004ULL,
+    0x0080204000800080ULL, 0x3008804000290100ULL, 0x1010100080200080ULL, 0x2008100208028080ULL,
+    0x5000850800910100ULL, 0x8402019004680200ULL, 0x0120911028020400ULL, 0x0000008044010200ULL,
+    0x0020850200244012ULL, 0x0020850200244012ULL, 0x0000102001040841ULL, 0x140900040A100021ULL,
+    0x000200282410A102ULL, 0x000200282410A102ULL, 0x000200282410A102ULL, 0x4048240043802106ULL
+};
+
+// pext is microcoded and slow on AMD before Zen 3, so CHESS_NO_PEXT in the
+// environment turns it off
+static bool cpu_has_pext() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    return __builtin_cpu_supports("bmi2") && !std::getenv("CHESS_NO_PEXT");
+#else
+    return false;
+#endif
+}
+
+// Work out the mask for each square and drop the answer for every occupancy
+// of it into the table at its index
+static void init_magics(Magic magics[64], const bitboard numbers[64], bitboard *table,
+                        bitboard (*slow_attacks)(int, bitboard)) {
+    for (int sq = 0; sq < 64; ++sq) {
+        Magic &m = magics[sq];
+        bitboard edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (8 * (sq / 8)))) |
+                         ((FILE_A | FILE_H) & ~(FILE_A << (sq % 8)));
+        m.mask = slow_attacks(sq, 0) & ~edges;
+        m.magic = numbers[sq];
+        m.shift = 64 - popcount(m.mask);
+        m.attacks = table;
+
+        // Every subset of the mask, by the carry-rippler trick
+        bitboard b = 0;
+        do {
+            bitboard &entry = m.attacks[m.index(b)];
+            assert(!entry || entry == slow_attacks(sq, b));
+            entry = slow_attacks(sq, b);
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        table += 1ULL << popcount(m.mask);
+    }
+}
+
+void init_attacks() {
+    static const bool done = [] {
+        USE_PEXT = cpu_has_pext();
+        init_magics(BISHOP_MAGICS, BISHOP_MAGIC_NUMBERS, BISHOP_TABLE, slow_bishop_attacks);
+        init_magics(ROOK_MAGICS, ROOK_MAGIC_NUMBERS, ROOK_TABLE, slow_rook_attacks);
+        return true;
+    }();
+    (void)done;
+}
+
+static bool check_magics(const Magic magics[64], bitboard (*slow_attacks)(int, bitboard)) {
+    for (int sq = 0; sq < 64; ++sq) {
+        const Magic &m = magics[sq];
+        std::vector<bitboard> seen(1ULL << (64 - m.shift), 0);
+        bitboard b = 0;
+        do {
+            bitboard answer = slow_attacks(sq, b);
+            bitboard &entry = seen[m.magic_index(b)];
+            if ((entry && entry != answer) || m.attacks[m.index(b)] != answer) {
+                return false;
+            }
+            entry = answer;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+    }
+    return true;
+}
+
+bool check_magics() {
+    init_attacks();
+    return check_magics(BISHOP_MAGICS, slow_bishop_attacks) && check_magics(ROOK_MAGICS, slow_rook_attacks);
+}
@@ -0,0 +1,186 @@
+#include <array>
+
+#pragma once
+
+#include "bitboard.hh"
+
+// Attack tables, indexed by square. The leaper tables are worked out by the
+// compiler and the slider tables once at start up (attacks.cc), so looking
+// up where a piece attacks is a load or two at run time.
+
+typedef std::array<bitboard, 64> square_table;
+
+enum DIRECTION {NORTH, EAST, NORTH_EAST, NORTH_WEST, SOUTH, WEST, SOUTH_EAST, SOUTH_WEST};
+
+constexpr bitboard step(const bitboard b, const int dir) {
+    switch (dir) {
+        case NORTH:      return north(b);
+        case EAST:       return east(b);
+        case NORTH_EAST: return north_east(b);
+        case NORTH_WEST: return north_west(b);
+        case SOUTH:      return south(b);
+        case WEST:       return west(b);
+        case SOUTH_EAST: return south_east(b);
+        default:         return south_west(b);
+    }
+}
+
+constexpr square_table make_knight_attacks() {
+    square_table t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        bitboard b = bit(sq);
+        bitboard one = east(b) | west(b);
+        bitboard two = east(east(b)) | west(west(b));
+        t[sq] = (one << 16) | (one >> 16) | (two << 8) | (two >> 8);
+    }
+    return t;
+}
+
+constexpr square_table make_king_attacks() {
+    square_table t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        bitboard b = bit(sq);
+        bitboard row = b | east(b) | west(b);
+        t[sq] = (row | north(row) | south(row)) ^ b;
+    }
+    return t;
+}
+
+constexpr std::array<square_table, 2> make_pawn_attacks() {
+    std::array<square_table, 2> t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        t[WHITE][sq] = north_east(bit(sq)) | north_west(bit(sq));
+        t[BLACK][sq] = south_east(bit(sq)) | south_west(bit(sq));
+    }
+    return t;
+}
+
+// Every square from a square to the edge of the board in one direction
+constexpr std::array<square_table, 8> make_rays() {
+    std::array<square_table, 8> t{};
+    for (int dir = 0; dir < 8; ++dir) {
+        for (int sq = 0; sq < 64; ++sq) {
+            bitboard b = step(bit(sq), dir);
+            while (b) {
+                t[dir][sq] |= b;
+                b = step(b, dir);
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr square_table KNIGHT_ATTACKS = make_knight_attacks();
+inline constexpr square_table KING_ATTACKS = make_king_attacks();
+inline constexpr std::array<square_table, 2> PAWN_ATTACKS = make_pawn_attacks();   // [colour][square]
+inline constexpr std::array<square_table, 8> RAYS = make_rays();                    // [direction][square]
+
+// The squares strictly between two squares on the same line, empty if they
+// aren't on one (or are next to each other)
+constexpr std::array<square_table, 64> make_between() {
+    std::array<square_table, 64> t{};
+    for (int from = 0; from < 64; ++from) {
+        for (int dir = 0; dir < 8; ++dir) {
+            for (int to = 0; to < 64; ++to) {
+                if (RAYS[dir][from] & bit(to)) {
+                    t[from][to] = RAYS[dir][from] & ~RAYS[dir][to] & ~bit(to);
+                }
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr std::array<square_table, 64> BETWEEN = make_between();             // [square][square]
+
+// A ray cut short at the first piece in the way (which is included). The
+// directions that count up the board stop at the lowest blocker, the ones
+// that count down at the highest.
+inline bitboard ray_attacks(const int square, const bitboard occupied, const int dir) {
+    bitboard ray = RAYS[dir][square];
+    bitboard blockers = ray & occupied;
+    if (blockers) {
+        int first = dir < SOUTH ? lsb(blockers) : msb(blockers);
+        ray ^= RAYS[dir][first];
+    }
+    return ray;
+}
+
+// The classical way of working out slider attacks, four rays at a time. Too
+// slow for move generation, but it is what the lookup tables are built from.
+inline bitboard slow_bishop_attacks(const int square, const bitboard occupied) {
+    return ray_attacks(square, occupied, NORTH_EAST) | ray_attacks(square, occupied, NORTH_WEST) |
+           ray_attacks(square, occupied, SOUTH_EAST) | ray_attacks(square, occupied, SOUTH_WEST);
+}
+
+inline bitboard slow_rook_attacks(const int square, const bitboard occupied) {
+    return ray_attacks(square, occupied, NORTH) | ray_attacks(square, occupied, EAST) |
+           ray_attacks(square, occupied, SOUTH) | ray_attacks(square, occupied, WEST);
+}
+
+// Magic bitboards. Only the pieces on a slider's rays (not counting the edge
+// squares, which never block anything) change where it attacks, so those
+// bits of the occupancy are squashed into an index into a table of every
+// answer for that square. On CPUs with BMI2 the index is pext of the mask,
+// which is exact. Everywhere else it is the masked occupancy times a magic
+// number, keeping the top bits. The magics were found offline, so that no two
+// occupancies with different answers share an index, and are compiled in;
+// only the attack tables are built at start up.
+struct Magic {
+    bitboard mask;          // Squares whose occupancy matters
+    bitboard magic;
+    bitboard *attacks;      // This square's part of the shared table
+    unsigned shift;         // 64 minus the number of bits in mask
+
+    unsigned index(const bitboard occupied) const;
+    // The index by the magic, whether or not pext is in use
+    unsigned magic_index(const bitboard occupied) const;
+};
+
+extern Magic BISHOP_MAGICS[64];
+extern Magic ROOK_MAGICS[64];
+extern bool USE_PEXT;
+
+// Fills in the magic tables. Safe to call more than once, only the first call
+// does anything; Board's constructor calls it, so nothing else needs to.
+void init_attacks();
+// Goes through every occupancy of every square by the magic index, even when
+// pext is the one in use: true if no two with different answers collide and
+// the tables give the right answer for each
+bool check_magics();
+
+inline unsigned pext(const bitboard b, const bitboard mask) {
+#if defined(__x86_64__)
+    // Written as asm so no target flags are needed to build it; it only runs
+    // when init_attacks has seen the CPU supports it
+    uint64_t result;
+    asm("pextq %2, %1, %0" : "=r"(result) : "r"(b), "r"(mask));
+    return result;
+#else
+    (void)b; (void)mask;
+    return 0;
+#endif
+}
+
+inline unsigned Magic::magic_index(const bitboard occupied) const {
+    return ((occupied & mask) * magic) >> shift;
+}
+
+inline unsigned Magic::index(const bitboard occupied) const {
+    if (USE_PEXT) return pext(occupied, mask);
+    return magic_index(occupied);
+}
+
+inline bitboard bishop_attacks(const int square, const bitboard occupied) {
+    const Magic &m = BISHOP_MAGICS[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline bitboard rook_attacks(const int square, const bitboard occupied) {
+    const Magic &m = ROOK_MAGICS[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline bitboard queen_attacks(const int square, const bitboard occupied) {
+    return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
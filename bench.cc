@@ -0,0 +1,298 @@
+#include "bench.hh"
+#include "perf_counters.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+
+typedef std::chrono::steady_clock Clock;
+
+// Opened the first time a benchmark asks for them. Says once if it can't.
+static Perf_Counters *hardware_counters() {
+    static Perf_Counters counters;
+    static bool warned = false;
+    if (!counters.available()) {
+        if (!warned) {
+            std::fprintf(stderr, "hardware counters unavailable (%s), timing only\n",
+                         counters.why_unavailable().c_str());
+            warned = true;
+        }
+        return nullptr;
+    }
+    return &counters;
+}
+
+Bench_Result run_bench(const std::string &name, const uint64_t ops, const Bench_Options &opts,
+                       const std::function<void()> &body, const std::function<void()> &setup) {
+    Bench_Result result{name, ops, {}, 0, 0, 0, 0, {}};
+    if (name.find(opts.filter) == std::string::npos) {
+        return result;
+    }
+    for (int i = 0; i < opts.warmup; ++i) {
+        if (setup) setup();
+        body();
+    }
+    Perf_Counters *counters = opts.counters ? hardware_counters() : nullptr;
+    Perf_Counters::counts totals{};
+    for (int i = 0; i < opts.reps; ++i) {
+        if (setup) setup();
+        if (counters) counters->start();
+        Clock::time_point start = Clock::now();
+        body();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (counters) {
+            Perf_Counters::counts c = counters->stop();
+            for (int e = 0; e < Perf_Counters::NUM_EVENTS; ++e) {
+                totals[e] += c[e];
+            }
+        }
+        result.samples.push_back(ns / ops);
+    }
+    if (counters) {
+        for (int e = 0; e < Perf_Counters::NUM_EVENTS; ++e) {
+            Perf_Counters::EVENT event = (Perf_Counters::EVENT)e;
+            if (counters->has(event)) {
+                result.counters.push_back({Perf_Counters::name(event), (double)totals[e] / ops / opts.reps});
+            }
+        }
+    }
+    summarize(result);
+    return result;
+}
+
+void summarize(Bench_Result &result) {
+    if (result.samples.empty()) {
+        return;
+    }
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    // Nearest rank, so with few repetitions this is the slowest one
+    size_t rank = (size_t)std::ceil(0.99 * n);
+    result.p99 = sorted[std::max<size_t>(rank, 1) - 1];
+    result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+    result.min = sorted[0];
+}
+
+// A counter's per-op value, or -1 if it wasn't read
+static double counter(const Bench_Result &r, const std::string &name) {
+    for (const auto &c : r.counters) {
+        if (c.first == name) {
+            return c.second;
+        }
+    }
+    return -1;
+}
+
+void print_results(const std::vector<Bench_Result> &results) {
+    std::printf("%-24s %10s %12s %12s %12s\n", "benchmark", "ops/rep", "median ns", "p99 ns", "min ns");
+    bool any_counters = false;
+    for (const Bench_Result &r : results) {
+        if (r.samples.empty()) {
+            continue;
+        }
+        std::printf("%-24s %10llu %12.1f %12.1f %12.1f\n", r.name.c_str(), (unsigned long long)r.ops,
+                    r.median, r.p99, r.min);
+        any_counters |= !r.counters.empty();
+    }
+    if (!any_counters) {
+        return;
+    }
+    // Per operation (per node, for the searches), "-" where a counter wasn't read
+    const char *names[] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+    std::printf("\n%-24s %10s %10s %6s %10s %10s %10s\n", "per op", "cycles", "instrs", "IPC", "br miss", "L1d miss", "LLC miss");
+    for (const Bench_Result &r : results) {
+        if (r.counters.empty()) {
+            continue;
+        }
+        std::printf("%-24s", r.name.c_str());
+        for (int i = 0; i < 5; ++i) {
+            double x = counter(r, names[i]);
+            if (i == 2) {
+                double cycles = counter(r, "cycles"), instrs = counter(r, "instructions");
+                if (cycles > 0 && instrs >= 0) {
+                    std::printf(" %6.2f", instrs / cycles);
+                } else {
+                    std::printf(" %6s", "-");
+                }
+            }
+            if (x >= 0) {
+                std::printf(" %10.2f", x);
+            } else {
+                std::printf(" %10s", "-");
+            }
+        }
+        std::printf("\n");
+    }
+}
+
+// Benchmark names are plain, but a quote or backslash shouldn't break the file
+static std::string json_string(const std::string &s) {
+    std::string ans = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ans += '\\';
+        }
+        ans += c;
+    }
+    return ans + "\"";
+}
+
+bool write_results(const std::string &path, const std::string &program, const std::vector<Bench_Result> &results) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    char number[32];
+    auto num = [&number](const double x) {
+        std::snprintf(number, sizeof(number), "%.3f", x);
+        return std::string(number);
+    };
+    out << "{\n  \"program\": " << json_string(program) << ",\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [";
+    bool first = true;
+    for (const Bench_Result &r : results) {
+        if (r.samples.empty()) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    {\"name\": " << json_string(r.name) << ", \"ops\": " << r.ops
+            << ", \"median\": " << num(r.median) << ", \"p99\": " << num(r.p99)
+            << ", \"mean\": " << num(r.mean) << ", \"min\": " << num(r.min) << ",\n     \"samples\": [";
+        for (size_t i = 0; i < r.samples.size(); ++i) {
+            out << (i ? ", " : "") << num(r.samples[i]);
+        }
+        out << "]";
+        if (!r.counters.empty()) {
+            out << ",\n     \"counters\": {";
+            for (size_t i = 0; i < r.counters.size(); ++i) {
+                out << (i ? ", " : "") << json_string(r.counters[i].first) << ": " << num(r.counters[i].second);
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    return (bool)out;
+}
+
+// Not a general JSON reader, only enough for what write_results writes: the
+// value after "key": inside one benchmark's {...}
+static bool find_value(const std::string &obj, const std::string &key, size_t &pos) {
+    pos = obj.find("\"" + key + "\"");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = obj.find(':', pos);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = obj.find_first_not_of(" \t\r\n", pos + 1);
+    return pos != std::string::npos;
+}
+
+static bool read_string(const std::string &obj, const std::string &key, std::string &value) {
+    size_t pos;
+    if (!find_value(obj, key, pos) || obj[pos] != '"') {
+        return false;
+    }
+    value.clear();
+    for (++pos; pos < obj.size() && obj[pos] != '"'; ++pos) {
+        if (obj[pos] == '\\' && pos + 1 < obj.size()) {
+            ++pos;
+        }
+        value += obj[pos];
+    }
+    return pos < obj.size();
+}
+
+static bool read_numbers(const std::string &obj, const std::string &key, std::vector<double> &values) {
+    size_t pos;
+    if (!find_value(obj, key, pos)) {
+        return false;
+    }
+    bool list = obj[pos] == '[';
+    size_t end = list ? obj.find(']', pos) : obj.find_first_of(",}", pos);
+    if (end == std::string::npos) {
+        end = obj.size();
+    }
+    const char *p = obj.c_str() + pos + list;
+    const char *stop = obj.c_str() + end;
+    values.clear();
+    while (p < stop) {
+        char *next;
+        double x = std::strtod(p, &next);
+        if (next == p) {
+            ++p;
+            continue;
+        }
+        values.push_back(x);
+        p = next;
+    }
+    return list || !values.empty();
+}
+
+bool read_results(const std::string &path, std::vector<Bench_Result> &results) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = text.find("\"benchmarks\"");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    results.clear();
+    while ((pos = text.find('{', pos)) != std::string::npos) {
+        // The matching brace, past the counters object if there is one
+        size_t end = pos;
+        for (int depth = 0; end < text.size(); ++end) {
+            depth += (text[end] == '{') - (text[end] == '}');
+            if (depth == 0) {
+                break;
+            }
+        }
+        if (end == text.size()) {
+            return false;
+        }
+        std::string obj = text.substr(pos, end - pos);
+        Bench_Result r{};
+        std::vector<double> ops;
+        if (!read_string(obj, "name", r.name) || !read_numbers(obj, "samples", r.samples) || r.samples.empty()) {
+            return false;
+        }
+        if (read_numbers(obj, "ops", ops)) {
+            r.ops = ops[0];
+        }
+        summarize(r);
+        results.push_back(r);
+        pos = end;
+    }
+    return !results.empty();
+}
+
+bool parse_bench_options(int argc, char **argv, Bench_Options &opts, std::vector<std::string> &rest) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--warmup" || arg == "--reps") && i + 1 < argc) {
+            int value = std::atoi(argv[++i]);
+            if (value < (arg == "--reps" ? 1 : 0)) {
+                return false;
+            }
+            (arg == "--reps" ? opts.reps : opts.warmup) = value;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            opts.filter = argv[++i];
+        } else if (arg == "--counters") {
+            opts.counters = true;
+        } else {
+            rest.push_back(arg);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma once
+
+// A small timing harness shared by the benchmark programs. A benchmark is a
+// function that does a known number of operations; it is run a few times to
+// warm up, then timed over a number of repetitions, and each repetition gives
+// one sample of nanoseconds per operation.
+
+struct Bench_Result {
+    std::string name;
+    uint64_t ops;                   // Operations done by one repetition
+    std::vector<double> samples;    // ns per operation, one per repetition
+    double median;
+    double p99;
+    double mean;
+    double min;
+    // Hardware counter totals per operation over all the repetitions, like
+    // {"cycles", 412.5}, when --counters was asked for and they could be read
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+struct Bench_Options {
+    int warmup = 3;
+    int reps = 25;
+    std::string filter;             // Only run benchmarks whose name contains this
+    bool counters = false;          // Read hardware counters around each repetition
+};
+
+// Keeps the compiler from throwing away work whose result is never used
+template <typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Times $body, which does $ops operations. $setup runs before each repetition
+// and isn't timed. Returns a result with no samples if the filter skips it.
+Bench_Result run_bench(const std::string &name, const uint64_t ops, const Bench_Options &opts,
+                       const std::function<void()> &body, const std::function<void()> &setup = nullptr);
+
+// Fills in median, p99, mean and min from the samples
+void summarize(Bench_Result &result);
+
+// One line per benchmark, for people
+void print_results(const std::vector<Bench_Result> &results);
+
+// JSON, for bench_compare and anything else: the samples go in too, so
+// confidence intervals can be worked out later
+bool write_results(const std::string &path, const std::string &program, const std::vector<Bench_Result> &results);
+
+// Reads back what write_results wrote. False if the file can't be read or
+// has no benchmarks in it.
+bool read_results(const std::string &path, std::vector<Bench_Result> &results);
+
+// Reads --warmup N, --reps N, --filter NAME and --counters, leaving any other
+// arguments in $rest. False on a bad value.
+bool parse_bench_options(int argc, char **argv, Bench_Options &opts, std::vector<std::string> &rest);
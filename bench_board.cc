@@ -0,0 +1,146 @@
+#include "Board.hh"
+#include "bench.hh"
+#include "perft.hh"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Times the Board calls the engines lean on, over a fixed set of positions:
+// the perft reference positions and a few ordinary middlegames. Results go to
+// stdout and, as JSON, to bench_output.txt (or --out FILE).
+//
+// usage: bench_board [--warmup N] [--reps N] [--filter NAME] [--counters] [--out FILE]
+
+const std::vector<std::string> MIDDLEGAMES = {
+    "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "r2q1rk1/pp1nbppp/2p1pn2/3p4/2PP1B2/2N1PN2/PPQ2PPP/R3KB1R w KQ - 0 9",
+    "2rq1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1P2PN2/PB1NBPPP/2RQ1RK1 w - - 0 12",
+    "r4rk1/1b2qppp/p2bpn2/1p6/3N4/P1N1B3/1PP1QPPP/R4RK1 b - - 3 15",
+};
+
+// Passes over the corpus in one repetition, so each repetition is long
+// enough for the clock to resolve
+const int ROUNDS = 100;
+
+int main(int argc, char **argv) {
+    Bench_Options opts;
+    std::vector<std::string> rest;
+    std::string out_path = "bench_output.txt";
+    if (!parse_bench_options(argc, argv, opts, rest)) {
+        std::printf("usage: bench_board [--warmup N] [--reps N] [--filter NAME] [--counters] [--out FILE]\n");
+        return 1;
+    }
+    for (size_t i = 0; i < rest.size(); ++i) {
+        if (rest[i] == "--out" && i + 1 < rest.size()) {
+            out_path = rest[++i];
+        } else {
+            std::printf("usage: bench_board [--warmup N] [--reps N] [--filter NAME] [--counters] [--out FILE]\n");
+            return 1;
+        }
+    }
+
+    // One board per position, set up ahead of time so only the call is timed
+    std::vector<std::unique_ptr<Board>> boards;
+    std::vector<board_array> arrays;
+    std::vector<MoveList> moves;
+    uint64_t total_moves = 0;
+    auto add_position = [&](const std::string &fen) {
+        boards.push_back(std::make_unique<Board>());
+        boards.back()->set_fen(fen);
+        arrays.push_back(boards.back()->get_board());
+        moves.emplace_back();
+        boards.back()->get_legal_moves(boards.back()->is_white_turn(), moves.back());
+        total_moves += moves.back().size();
+    };
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        add_position(pos.fen);
+    }
+    for (const std::string &fen : MIDDLEGAMES) {
+        add_position(fen);
+    }
+    const uint64_t positions = boards.size() * ROUNDS;
+
+    // A fixed game for play_move: from the start, always the move a third of
+    // the way down the list, until the game ends or 120 plies
+    const std::string start_fen = PERFT_SUITE[0].fen;
+    Board player;
+    std::vector<PackedMove> line;
+    player.set_fen(start_fen);
+    while (line.size() < 120 && !player.game_over()) {
+        MoveList ml;
+        player.get_legal_moves(player.is_white_turn(), ml);
+        line.push_back(ml[ml.size() / 3]);
+        player.play_move(line.back());
+    }
+
+    std::vector<Bench_Result> results;
+    results.push_back(run_bench("get_legal_moves", positions, opts, [&] {
+        MoveList ml;
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto &b : boards) {
+                b->get_legal_moves(b->is_white_turn(), ml);
+                keep(ml);
+            }
+        }
+    }));
+    results.push_back(run_bench("make_unmake", total_moves * ROUNDS, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (size_t i = 0; i < boards.size(); ++i) {
+                for (const PackedMove &m : moves[i]) {
+                    UndoInfo undo = boards[i]->make_move(m);
+                    boards[i]->unmake_move(m, undo);
+                }
+            }
+        }
+    }));
+    results.push_back(run_bench("play_move", line.size(), opts, [&] {
+        for (const PackedMove &m : line) {
+            player.play_move(m);
+        }
+    }, [&] {
+        player.set_fen(start_fen);
+    }));
+    results.push_back(run_bench("game_over", positions, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto &b : boards) {
+                bool over = b->game_over();
+                keep(over);
+            }
+        }
+    }));
+    results.push_back(run_bench("white_wins", positions, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto &b : boards) {
+                bool won = b->white_wins();
+                keep(won);
+            }
+        }
+    }));
+    results.push_back(run_bench("to_string", positions, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto &b : boards) {
+                std::string s = b->to_string();
+                keep(s);
+            }
+        }
+    }));
+    Board scratch;
+    results.push_back(run_bench("set_board", positions, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (const board_array &a : arrays) {
+                scratch.set_board(a);
+                keep(scratch);
+            }
+        }
+    }));
+
+    print_results(results);
+    if (!write_results(out_path, "bench_board", results)) {
+        std::printf("couldn't write %s\n", out_path.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "bench.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Compares two benchmark result files (as written by bench_board and
+// bench_engine) benchmark by benchmark.
+//
+// usage: bench_compare [--threshold PCT] [--hot NAME,NAME,...] <baseline> <candidate>
+//
+// Times are ns per operation, so a positive change is a slowdown. The 95%
+// interval on each change comes from bootstrapping the repetitions. A hot
+// path regresses when its median is more than the threshold (default 5%)
+// slower and the interval doesn't reach down to zero, i.e. it isn't noise.
+// Exits 1 if any hot path regressed or is missing from the candidate, 2 if
+// the files can't be read. bench_board and bench_engine write separate files,
+// so compare each against its own baseline.
+
+// Benchmarks whose names contain one of these count as hot paths: move
+// generation and make/unmake from bench_board, evaluation and search speed
+// (ns per node) from bench_engine
+const std::vector<std::string> DEFAULT_HOT = {"get_legal_moves", "make_unmake", "evaluate", "search"};
+
+const int RESAMPLES = 2000;
+
+double median_of(std::vector<double> &v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// 95% interval on candidate median / baseline median - 1, by resampling each
+// side's repetitions with replacement. The seed is fixed so the same files
+// always give the same answer.
+void bootstrap(const std::vector<double> &base, const std::vector<double> &cand, double &lo, double &hi) {
+    std::mt19937_64 rng(12345);
+    std::vector<double> changes, a(base.size()), b(cand.size());
+    std::uniform_int_distribution<size_t> pick_a(0, base.size() - 1), pick_b(0, cand.size() - 1);
+    for (int i = 0; i < RESAMPLES; ++i) {
+        for (double &x : a) x = base[pick_a(rng)];
+        for (double &x : b) x = cand[pick_b(rng)];
+        changes.push_back(median_of(b) / median_of(a) - 1);
+    }
+    std::sort(changes.begin(), changes.end());
+    lo = changes[RESAMPLES * 25 / 1000];
+    hi = changes[RESAMPLES * 975 / 1000 - 1];
+}
+
+bool is_hot(const std::string &name, const std::vector<std::string> &hot) {
+    for (const std::string &h : hot) {
+        if (name.find(h) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void print_usage() {
+    std::printf("usage: bench_compare [--threshold PCT] [--hot NAME,NAME,...] <baseline> <candidate>\n");
+}
+
+int main(int argc, char **argv) {
+    double threshold = 5;
+    std::vector<std::string> hot = DEFAULT_HOT;
+    bool hot_given = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--hot" && i + 1 < argc) {
+            hot.clear();
+            hot_given = true;
+            std::istringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) {
+                    hot.push_back(name);
+                }
+            }
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2 || threshold < 0) {
+        print_usage();
+        return 2;
+    }
+    std::vector<Bench_Result> base, cand;
+    if (!read_results(files[0], base)) {
+        std::printf("can't read %s\n", files[0].c_str());
+        return 2;
+    }
+    if (!read_results(files[1], cand)) {
+        std::printf("can't read %s\n", files[1].c_str());
+        return 2;
+    }
+
+    int regressions = 0, missing = 0;
+    std::printf("%-24s %12s %12s %9s %20s\n", "benchmark", "base ns", "new ns", "change", "95% interval");
+    for (const Bench_Result &b : base) {
+        auto c = std::find_if(cand.begin(), cand.end(), [&b](const Bench_Result &r) { return r.name == b.name; });
+        if (c == cand.end()) {
+            bool hot_path = is_hot(b.name, hot);
+            missing += hot_path;
+            std::printf("%-24s %12.1f %12s %s\n", b.name.c_str(), b.median, "missing", hot_path ? "MISSING" : "");
+            continue;
+        }
+        double change = c->median / b.median - 1;
+        double lo, hi;
+        bootstrap(b.samples, c->samples, lo, hi);
+        bool hot_path = is_hot(b.name, hot);
+        bool regressed = hot_path && change * 100 > threshold && lo > 0;
+        regressions += regressed;
+        std::printf("%-24s %12.1f %12.1f %+8.1f%% [%+7.1f%%, %+7.1f%%] %s\n", b.name.c_str(), b.median, c->median,
+                    100 * change, 100 * lo, 100 * hi, regressed ? "REGRESSED" : hot_path ? "hot" : "");
+    }
+    for (const Bench_Result &c : cand) {
+        if (std::none_of(base.begin(), base.end(), [&c](const Bench_Result &r) { return r.name == c.name; })) {
+            std::printf("%-24s %12s %12.1f\n", c.name.c_str(), "new", c.median);
+        }
+    }
+    // A hot name asked for with --hot that matches nothing in either file
+    // can't be checked either. The defaults cover both bench programs, so
+    // a file from one of them never has all of them.
+    for (const std::string &h : hot_given ? hot : std::vector<std::string>{}) {
+        auto matches = [&h](const Bench_Result &r) { return is_hot(r.name, {h}); };
+        if (std::none_of(base.begin(), base.end(), matches) && std::none_of(cand.begin(), cand.end(), matches)) {
+            std::printf("no benchmark matches hot path %s\n", h.c_str());
+            ++missing;
+        }
+    }
+    if (regressions) {
+        std::printf("\n%d hot path%s slower by more than %.1f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+    }
+    if (missing) {
+        std::printf("\n%d hot path%s missing from %s\n", missing, missing == 1 ? "" : "s", files[1].c_str());
+    }
+    return regressions || missing ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+#include "Board.hh"
+#include "bench.hh"
+#include "engine_bench.hh"
+#include "evaluation.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Times the engine side: the static evaluation over the bench positions, and
+// a whole search of them to a fixed depth, as ns per node. Results go to
+// stdout and, as JSON, to bench_engine_output.txt (or --out FILE), in the
+// same form as bench_board's so bench_compare can read either.
+//
+// usage: bench_engine [--warmup N] [--reps N] [--filter NAME] [--counters]
+//                     [--engine NAME] [--depth N] [--out FILE]
+
+// Passes over the positions in one repetition of evaluate
+const int ROUNDS = 1000;
+
+// Shallower than the bench command, so 25 repetitions don't take minutes
+const int SEARCH_DEPTH = BENCH_DEPTH - 1;
+
+void print_usage() {
+    std::printf("usage: bench_engine [--warmup N] [--reps N] [--filter NAME] [--counters]\n"
+                "                    [--engine NAME] [--depth N] [--out FILE]\n");
+}
+
+// The search makes a fresh engine and table for every position, so rather
+// than time the whole call each repetition is the search time engine_bench
+// measures over the nodes it searched. The node count doesn't change from
+// one repetition to the next.
+Bench_Result search_bench(const std::string &name, const std::string &engine, const int depth,
+                          const Bench_Options &opts, bool &ok) {
+    Bench_Result result{name, 0, {}, 0, 0, 0, 0, {}};
+    ok = true;
+    if (name.find(opts.filter) == std::string::npos) {
+        return result;
+    }
+    Engine_Bench run;
+    for (int i = 0; i < opts.warmup + opts.reps; ++i) {
+        if (!engine_bench(engine, depth, run, false)) {
+            ok = false;
+            return result;
+        }
+        if (i >= opts.warmup && run.nodes) {
+            result.samples.push_back(run.seconds * 1e9 / run.nodes);
+        }
+    }
+    result.ops = run.nodes;
+    summarize(result);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    Bench_Options opts;
+    std::vector<std::string> rest;
+    std::string out_path = "bench_engine_output.txt";
+    std::string engine = "alphabeta";
+    int depth = SEARCH_DEPTH;
+    if (!parse_bench_options(argc, argv, opts, rest)) {
+        print_usage();
+        return 1;
+    }
+    for (size_t i = 0; i < rest.size(); ++i) {
+        if (rest[i] == "--out" && i + 1 < rest.size()) {
+            out_path = rest[++i];
+        } else if (rest[i] == "--engine" && i + 1 < rest.size()) {
+            engine = rest[++i];
+        } else if (rest[i] == "--depth" && i + 1 < rest.size()) {
+            depth = std::atoi(rest[++i].c_str());
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (depth < 1) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Board>> boards;
+    for (const std::string &fen : BENCH_POSITIONS) {
+        boards.push_back(std::make_unique<Board>());
+        boards.back()->set_fen(fen);
+    }
+
+    std::vector<Bench_Result> results;
+    results.push_back(run_bench("evaluate", boards.size() * ROUNDS, opts, [&] {
+        for (int r = 0; r < ROUNDS; ++r) {
+            for (auto &b : boards) {
+                int score = pst_score(*b);
+                keep(score);
+            }
+        }
+    }));
+    bool ok;
+    results.push_back(search_bench("search", engine, depth, opts, ok));
+    if (!ok) {
+        print_usage();
+        return 1;
+    }
+
+    print_results(results);
+    if (!write_results(out_path, "bench_engine", results)) {
+        std::printf("couldn't write %s\n", out_path.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <cstdint>
+
+#pragma once
+
+// One bit per square, bit 0 is a1, bit 63 is h8 (same order as board_array)
+typedef uint64_t bitboard;
+
+enum PLAYER {BLACK = 0, WHITE = 1};
+
+// Piece types. A piece on the board is its type with the colour in bit 3,
+// so 'p' is make_piece(BLACK, PAWN) and 'Q' is make_piece(WHITE, QUEEN).
+enum PIECE {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, EMPTY};
+
+enum SQUARE {
+    A1, B1, C1, D1, E1, F1, G1, H1,
+    A2, B2, C2, D2, E2, F2, G2, H2,
+    A3, B3, C3, D3, E3, F3, G3, H3,
+    A4, B4, C4, D4, E4, F4, G4, H4,
+    A5, B5, C5, D5, E5, F5, G5, H5,
+    A6, B6, C6, D6, E6, F6, G6, H6,
+    A7, B7, C7, D7, E7, F7, G7, H7,
+    A8, B8, C8, D8, E8, F8, G8, H8,
+    NO_SQUARE
+};
+
+const bitboard FILE_A = 0x0101010101010101ULL;
+const bitboard FILE_H = FILE_A << 7;
+const bitboard RANK_1 = 0xFFULL;
+const bitboard RANK_2 = RANK_1 << 8;
+const bitboard RANK_4 = RANK_1 << 24;
+const bitboard RANK_5 = RANK_1 << 32;
+const bitboard RANK_7 = RANK_1 << 48;
+const bitboard RANK_8 = RANK_1 << 56;
+
+inline constexpr uint8_t make_piece(const int color, const int type) {
+    return type | (color << 3);
+}
+
+inline constexpr int type_of(const uint8_t piece) {
+    return piece & 7;
+}
+
+inline constexpr int color_of(const uint8_t piece) {
+    return piece >> 3;
+}
+
+inline constexpr bitboard bit(const int square) {
+    return 1ULL << square;
+}
+
+inline int lsb(const bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+inline int msb(const bitboard b) {
+    return 63 - __builtin_clzll(b);
+}
+
+// Returns the lowest set square and clears it from b
+inline int pop_lsb(bitboard &b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+inline int popcount(const bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+// Shift every square of the set one step in a direction, dropping whatever
+// falls off the edge of the board
+inline constexpr bitboard north(const bitboard b) { return b << 8; }
+inline constexpr bitboard south(const bitboard b) { return b >> 8; }
+inline constexpr bitboard east(const bitboard b)  { return (b & ~FILE_H) << 1; }
+inline constexpr bitboard west(const bitboard b)  { return (b & ~FILE_A) >> 1; }
+inline constexpr bitboard north_east(const bitboard b) { return (b & ~FILE_H) << 9; }
+inline constexpr bitboard north_west(const bitboard b) { return (b & ~FILE_A) << 7; }
+inline constexpr bitboard south_east(const bitboard b) { return (b & ~FILE_H) >> 7; }
+inline constexpr bitboard south_west(const bitboard b) { return (b & ~FILE_A) >> 9; }
\ No newline at end of file
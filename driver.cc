@@ -1,25 +1,154 @@
 #include "Board.hh"
 #include "Engine.hh"
+#include "engine_bench.hh"
 
-void play_game(Board& board, Engine& e1, Engine& e2) {
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// driver [-n games] [-w engine] [-b engine] [-c clock ms] [-i increment ms]
+// driver bench [engine (alphabeta)] [depth]
+//
+// Plays games between two engines on one board, back to back, and reports
+// how fast they went: games and plies per second, and the average time the
+// engines took per get_move. Both engines default to "random". With -c the
+// games are played on a clock: each side starts with that long, gets the
+// increment back after every move, and loses if it runs out.
+//
+// bench searches the bench positions with an engine ("alphabeta" if not
+// given) to a fixed depth (BENCH_DEPTH if not given) and prints the total
+// nodes, which should only change when the search does, and the nodes per
+// second.
+
+typedef std::chrono::steady_clock Clock;
+
+struct Game_Stats {
+    uint64_t games;
+    uint64_t plies;
+    uint64_t white_wins;
+    uint64_t black_wins;
+    uint64_t time_losses;           // Included in the wins
+    Clock::duration move_time;      // Spent inside get_move
+};
+
+// Time control for the games, none if clock_ms is 0
+struct Time_Control {
+    uint64_t clock_ms;
+    uint64_t increment_ms;
+};
+
+// Plays one game from the start, adding it to stats. The board is reset, not
+// rebuilt, so its memory is reused from game to game.
+void play_game(Board& board, Engine& e1, Engine& e2, const Time_Control &tc, Game_Stats &stats) {
     board.reset();
-    Move m{"",""};
-    while( !board.game_over() ){
-        board.play_move(e1.get_move(m));
-        if(board.game_over()){
-            break;
+    PackedMove m{};
+    Engine *engines[2] = {&e1, &e2};
+    double clocks[2] = {(double)tc.clock_ms, (double)tc.clock_ms};
+    int flagged = -1;
+    for (int side = 0; !board.game_over(); side ^= 1) {
+        if (tc.clock_ms) {
+            Search_Limits limits{};
+            limits.clock_ms = clocks[side];
+            limits.increment_ms = tc.increment_ms;
+            engines[side]->set_limits(limits);
+        }
+        Clock::time_point start = Clock::now();
+        m = engines[side]->get_move(m);
+        Clock::duration took = Clock::now() - start;
+        stats.move_time += took;
+        if (tc.clock_ms) {
+            clocks[side] -= std::chrono::duration<double, std::milli>(took).count();
+            if (clocks[side] < 0) {
+                flagged = side;
+                break;
+            }
+            clocks[side] += tc.increment_ms;
         }
-        board.play_move(e2.get_move(m));
+        board.play_move(m);
+        ++stats.plies;
     }
-    e1.process_result(board.white_wins(), board.black_wins());
-    e2.process_result(board.black_wins(), board.white_wins());
+    bool white_won = flagged == 1 || (flagged < 0 && board.white_wins());
+    bool black_won = flagged == 0 || (flagged < 0 && board.black_wins());
+    ++stats.games;
+    stats.white_wins += white_won;
+    stats.black_wins += black_won;
+    stats.time_losses += flagged >= 0;
+    e1.process_result(white_won, black_won);
+    e2.process_result(black_won, white_won);
 }
 
-int main(int args, char** argv) {
-    Board board{};
-    Engine e1{board, true};
-    Engine e2{board, false};
-    play_game(board, e1, e2);
+void print_usage() {
+    std::printf("usage: driver [-n games] [-w white engine] [-b black engine] [-c clock ms] [-i increment ms]\n"
+                "       driver bench [engine (alphabeta)] [depth]\nengines:");
+    for (const std::string &name : ENGINE_NAMES) {
+        std::printf(" %s", name.c_str());
+    }
+    std::printf("\n");
+}
+
+int run_bench(const std::string &engine, const int depth) {
+    Engine_Bench result;
+    if (depth < 1 || !engine_bench(engine, depth, result)) {
+        print_usage();
+        return 1;
+    }
+    std::printf("\n%s depth %d\nnodes: %llu\ntime:  %.3f s\nnps:   %.0f\n", engine.c_str(), depth,
+                (unsigned long long)result.nodes, result.seconds,
+                result.seconds > 0 ? result.nodes / result.seconds : 0.0);
     return 0;
 }
 
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        return run_bench(argc > 2 ? argv[2] : "alphabeta", argc > 3 ? std::atoi(argv[3]) : BENCH_DEPTH);
+    }
+    long games = 1;
+    std::string white_name = "random", black_name = "random";
+    Time_Control tc{};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            games = std::atol(argv[++i]);
+        } else if (arg == "-w" && i + 1 < argc) {
+            white_name = argv[++i];
+        } else if (arg == "-b" && i + 1 < argc) {
+            black_name = argv[++i];
+        } else if (arg == "-c" && i + 1 < argc) {
+            tc.clock_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-i" && i + 1 < argc) {
+            tc.increment_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    Board board{};
+    std::unique_ptr<Engine> e1 = make_engine(white_name, board, true);
+    std::unique_ptr<Engine> e2 = make_engine(black_name, board, false);
+    if (games < 1 || !e1 || !e2) {
+        print_usage();
+        return 1;
+    }
+
+    Game_Stats stats{};
+    Clock::time_point start = Clock::now();
+    for (long g = 0; g < games; ++g) {
+        play_game(board, *e1, *e2, tc, stats);
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double move_time = std::chrono::duration<double>(stats.move_time).count();
+
+    std::printf("%s vs %s: %llu games, +%llu =%llu -%llu (white's view), %llu plies in %.3f s\n",
+                white_name.c_str(), black_name.c_str(), (unsigned long long)stats.games,
+                (unsigned long long)stats.white_wins,
+                (unsigned long long)(stats.games - stats.white_wins - stats.black_wins),
+                (unsigned long long)stats.black_wins, (unsigned long long)stats.plies, elapsed);
+    if (tc.clock_ms) {
+        std::printf("lost on time: %llu\n", (unsigned long long)stats.time_losses);
+    }
+    std::printf("games/s:  %.2f\nplies/s:  %.0f\nget_move: %.3f us average\n",
+                elapsed > 0 ? stats.games / elapsed : 0.0, elapsed > 0 ? stats.plies / elapsed : 0.0,
+                stats.plies ? move_time * 1e6 / stats.plies : 0.0);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#pragma once
+
+// The bench command: search a fixed set of positions to a fixed depth, one
+// thread, and add up the nodes. The node count is a signature of the
+// search (anything that changes what it does changes the count) and the
+// nodes per second are a quick check on speed. The positions cover the
+// opening, middlegame and endgame, with a couple of stalemates for the
+// no-moves path.
+
+extern const std::vector<std::string> BENCH_POSITIONS;
+const int BENCH_DEPTH = 5;
+
+struct Engine_Bench {
+    uint64_t nodes;
+    double seconds;
+};
+
+// Runs engine over BENCH_POSITIONS, a fresh engine and board for each so no
+// position depends on the ones before, printing a line a position if verbose.
+// Returns false if there's no engine by that name.
+bool engine_bench(const std::string &engine, const int depth, Engine_Bench &ans, const bool verbose=true);
@@ -0,0 +1,225 @@
+#include "Board.hh"
+#include "Engine.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// epd [-e engine] [-n nodes] [-t ms] [-d depth] [-H hash MB] <file>
+//
+// Runs an engine over a test suite in Extended Position Description, one
+// position a line: the first four FEN fields, then operations like
+//   bm Nf3 Qd2; am Bxh7+; id "WAC.004";
+// A position is solved if the engine's move is one of the bm moves and none
+// of the am moves. The file is read a line at a time, so suites of any size
+// are fine. Reports each position as it goes, then the solve rate and NPS.
+// The engine defaults to "alphabeta".
+
+typedef std::chrono::steady_clock Clock;
+
+struct Epd_Position {
+    std::string fen;
+    std::string id;
+    std::vector<std::string> best;      // bm: any of these solves it
+    std::vector<std::string> avoid;     // am: none of these may be played
+};
+
+// Splits an EPD line into the position and the operations we use. Returns
+// false for lines with no position on them.
+bool parse_epd(const std::string &line, Epd_Position &pos) {
+    std::istringstream in(line);
+    std::string field;
+    pos = Epd_Position{};
+    for (int i = 0; i < 4; ++i) {
+        if (!(in >> field)) {
+            return false;
+        }
+        pos.fen += (i ? " " : "") + field;
+    }
+    std::string rest;
+    std::getline(in, rest);
+    std::istringstream ops(rest);
+    std::string op;
+    while (std::getline(ops, op, ';')) {
+        std::istringstream words(op);
+        std::string code, arg;
+        words >> code;
+        if (code == "bm" || code == "am") {
+            while (words >> arg) {
+                (code == "bm" ? pos.best : pos.avoid).push_back(arg);
+            }
+        } else if (code == "id") {
+            std::getline(words >> std::ws, arg);
+            if (arg.size() >= 2 && arg.front() == '"' && arg.back() == '"') {
+                arg = arg.substr(1, arg.size() - 2);
+            }
+            pos.id = arg;
+        }
+    }
+    return true;
+}
+
+// Reads the bm/am moves off the position. Returns false if any of them
+// isn't a legal move here, since then the suite and the board disagree.
+bool read_moves(const Board &board, const std::vector<std::string> &sans, std::vector<PackedMove> &ans) {
+    for (const std::string &san : sans) {
+        PackedMove m = board.parse_san(san);
+        if (m.is_null()) {
+            return false;
+        }
+        ans.push_back(m);
+    }
+    return true;
+}
+
+bool solves(const PackedMove m, const std::vector<PackedMove> &best, const std::vector<PackedMove> &avoid) {
+    for (const PackedMove &a : avoid) {
+        if (m == a) {
+            return false;
+        }
+    }
+    if (best.empty()) {
+        return !avoid.empty();
+    }
+    for (const PackedMove &b : best) {
+        if (m == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string join(const std::vector<std::string> &words) {
+    std::string ans;
+    for (const std::string &w : words) {
+        ans += (ans.empty() ? "" : " ") + w;
+    }
+    return ans;
+}
+
+void print_usage() {
+    std::printf("usage: epd [-e engine] [-n nodes] [-t ms] [-d depth] [-H hash MB] <file>\nengines:");
+    for (const std::string &name : ENGINE_NAMES) {
+        std::printf(" %s", name.c_str());
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char **argv) {
+    std::string engine_name = "alphabeta", path;
+    Search_Limits limits{};
+    size_t hash_mb = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-e" && i + 1 < argc) {
+            engine_name = argv[++i];
+        } else if (arg == "-n" && i + 1 < argc) {
+            limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-t" && i + 1 < argc) {
+            limits.time_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-d" && i + 1 < argc) {
+            limits.depth = std::atoi(argv[++i]);
+        } else if (arg == "-H" && i + 1 < argc) {
+            hash_mb = std::strtoull(argv[++i], nullptr, 10);
+        } else if (path.empty() && arg[0] != '-') {
+            path = arg;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    Board board;
+    // One engine per side, kept for the whole suite, so whatever they set up
+    // once (tables and such) isn't redone for every position
+    std::unique_ptr<Engine> engines[2] = {make_engine(engine_name, board, false),
+                                          make_engine(engine_name, board, true)};
+    if (path.empty() || !engines[0] || !engines[1]) {
+        print_usage();
+        return 1;
+    }
+    std::ifstream in(path);
+    if (!in) {
+        std::printf("can't read %s\n", path.c_str());
+        return 1;
+    }
+
+    // Time to solution: when the engine settled on a solving move for good
+    std::vector<PackedMove> best, avoid;
+    double solved_at = -1;
+    for (auto &e : engines) {
+        if (hash_mb) {
+            e->set_hash_size(hash_mb);
+        }
+        e->set_limits(limits);
+        e->set_info_callback([&](const Search_Info &info) {
+            if (!solves(info.best, best, avoid)) {
+                solved_at = -1;
+            } else if (solved_at < 0) {
+                solved_at = info.seconds;
+            }
+        });
+    }
+
+    int positions = 0, solved = 0, skipped = 0;
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+    std::clock_t cpu_start = std::clock();
+    std::string line;
+    for (int line_no = 1; std::getline(in, line); ++line_no) {
+        Epd_Position pos;
+        if (!parse_epd(line, pos)) {
+            continue;
+        }
+        std::string name = pos.id.empty() ? "line " + std::to_string(line_no) : pos.id;
+        best.clear();
+        avoid.clear();
+        if (!board.set_fen(pos.fen) || !read_moves(board, pos.best, best) || !read_moves(board, pos.avoid, avoid) ||
+            (best.empty() && avoid.empty())) {
+            std::printf("%-20s skipped, can't read the position or its bm/am moves\n", name.c_str());
+            ++skipped;
+            continue;
+        }
+
+        Engine &engine = *engines[board.is_white_turn()];
+        solved_at = -1;
+        Clock::time_point start = Clock::now();
+        PackedMove m = engine.get_move(PackedMove{});
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        bool ok = solves(m, best, avoid);
+        if (!ok) {
+            solved_at = -1;
+        } else if (solved_at < 0) {
+            // Engines that never report still get a time: all of it
+            solved_at = elapsed;
+        }
+        ++positions;
+        solved += ok;
+        total_nodes += engine.nodes();
+        total_seconds += elapsed;
+
+        std::string expected = pos.best.empty() ? "am " + join(pos.avoid) : "bm " + join(pos.best);
+        std::printf("%-20s %-8s %s %-24s", name.c_str(), m.is_null() ? "(none)" : board.san(m).c_str(),
+                    ok ? "ok  " : "FAIL", expected.c_str());
+        if (ok) {
+            std::printf(" solved in %8.3f s", solved_at);
+        } else {
+            std::printf("                    ");
+        }
+        std::printf(" %12llu nodes %8.3f s\n", (unsigned long long)engine.nodes(), elapsed);
+    }
+    double cpu_seconds = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    std::printf("\n%d of %d solved", solved, positions);
+    if (skipped) {
+        std::printf(" (%d skipped)", skipped);
+    }
+    std::printf(", %llu nodes in %.3f s, %.0f nps, %.2f solved per cpu second\n",
+                (unsigned long long)total_nodes, total_seconds, total_seconds > 0 ? total_nodes / total_seconds : 0.0,
+                cpu_seconds > 0 ? solved / cpu_seconds : 0.0);
+    return 0;
+}
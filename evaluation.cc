@@ -0,0 +1,114 @@
+#include "evaluation.hh"
+#include "bitboard.hh"
+
+#include <array>
+
+extern const int PIECE_VALUES[6] = {100, 320, 330, 500, 900, 0};
+
+// Drawn from white's side with rank 8 on top, so white's square s reads
+// entry s ^ 56 and black's square s reads entry s
+typedef std::array<int, 64> table;
+
+const table PAWN_TABLE = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+     50, 50, 50, 50, 50, 50, 50, 50,
+     10, 10, 20, 30, 30, 20, 10, 10,
+      5,  5, 10, 25, 25, 10,  5,  5,
+      0,  0,  0, 20, 20,  0,  0,  0,
+      5, -5,-10,  0,  0,-10, -5,  5,
+      5, 10, 10,-20,-20, 10, 10,  5,
+      0,  0,  0,  0,  0,  0,  0,  0
+};
+const table KNIGHT_TABLE = {
+    -50,-40,-30,-30,-30,-30,-40,-50,
+    -40,-20,  0,  0,  0,  0,-20,-40,
+    -30,  0, 10, 15, 15, 10,  0,-30,
+    -30,  5, 15, 20, 20, 15,  5,-30,
+    -30,  0, 15, 20, 20, 15,  0,-30,
+    -30,  5, 10, 15, 15, 10,  5,-30,
+    -40,-20,  0,  5,  5,  0,-20,-40,
+    -50,-40,-30,-30,-30,-30,-40,-50
+};
+const table BISHOP_TABLE = {
+    -20,-10,-10,-10,-10,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5, 10, 10,  5,  0,-10,
+    -10,  5,  5, 10, 10,  5,  5,-10,
+    -10,  0, 10, 10, 10, 10,  0,-10,
+    -10, 10, 10, 10, 10, 10, 10,-10,
+    -10,  5,  0,  0,  0,  0,  5,-10,
+    -20,-10,-10,-10,-10,-10,-10,-20
+};
+const table ROOK_TABLE = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+      5, 10, 10, 10, 10, 10, 10,  5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+      0,  0,  0,  5,  5,  0,  0,  0
+};
+const table QUEEN_TABLE = {
+    -20,-10,-10, -5, -5,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5,  5,  5,  5,  0,-10,
+     -5,  0,  5,  5,  5,  5,  0, -5,
+      0,  0,  5,  5,  5,  5,  0, -5,
+    -10,  5,  5,  5,  5,  5,  0,-10,
+    -10,  0,  5,  0,  0,  0,  0,-10,
+    -20,-10,-10, -5, -5,-10,-10,-20
+};
+const table KING_MIDDLE_TABLE = {
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -20,-30,-30,-40,-40,-30,-30,-20,
+    -10,-20,-20,-20,-20,-20,-20,-10,
+     20, 20,  0,  0,  0,  0, 20, 20,
+     20, 30, 10,  0,  0, 10, 30, 20
+};
+const table KING_END_TABLE = {
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50
+};
+
+const table *PIECE_TABLES[5] = {&PAWN_TABLE, &KNIGHT_TABLE, &BISHOP_TABLE, &ROOK_TABLE, &QUEEN_TABLE};
+
+// How much of the middlegame is left, from the pieces still on: 24 with
+// everything on, 0 with only kings and pawns
+const int PHASE_WEIGHTS[5] = {0, 1, 1, 2, 4};
+const int MAX_PHASE = 24;
+
+int pst_score(const Board &board) {
+    int score = 0;
+    int phase = 0;
+    for (int color = BLACK; color <= WHITE; ++color) {
+        int sign = color == WHITE ? 1 : -1;
+        int flip = color == WHITE ? 56 : 0;
+        for (int type = PAWN; type <= QUEEN; ++type) {
+            bitboard bb = board.pieces(color, type);
+            phase += PHASE_WEIGHTS[type] * popcount(bb);
+            while (bb) {
+                score += sign * (PIECE_VALUES[type] + (*PIECE_TABLES[type])[pop_lsb(bb) ^ flip]);
+            }
+        }
+    }
+    phase = phase < MAX_PHASE ? phase : MAX_PHASE;
+    for (int color = BLACK; color <= WHITE; ++color) {
+        bitboard bb = board.pieces(color, KING);
+        if (bb) {
+            int sq = lsb(bb) ^ (color == WHITE ? 56 : 0);
+            int king = (KING_MIDDLE_TABLE[sq] * phase + KING_END_TABLE[sq] * (MAX_PHASE - phase)) / MAX_PHASE;
+            score += color == WHITE ? king : -king;
+        }
+    }
+    return score;
+}
@@ -1,3 +1,19 @@
 #include <functional>
 
-using eval_fn = std::function<double(Board&)>;
\ No newline at end of file
+#pragma once
+
+#include "Board.hh"
+
+using eval_fn = std::function<double(Board&)>;
+
+// Scores every position the same, for when there's nothing better to hand in
+inline double null_eval(Board&) { return 0; }
+// Centipawns for pawn, knight, bishop, rook and queen, then 0 for the king
+extern const int PIECE_VALUES[6];
+
+// Material plus piece-square tables, in centipawns for white. The king's
+// table slides from its middlegame one to its endgame one as pieces come off.
+int pst_score(const Board &board);
+
+// pst_score in pawns, as an eval_fn
+inline double pst_eval(Board &board) { return pst_score(board) / 100.0; }
@@ -0,0 +1,118 @@
+#include "perf_counters.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *Perf_Counters::name(const EVENT e) {
+    static const char *names[NUM_EVENTS] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+    return names[e];
+}
+
+#ifdef __linux__
+
+static int open_event(const uint32_t type, const uint64_t config, const int group) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0;      // Members follow the leader
+    // User space only, which is all perf_event_paranoid 2 allows and all we want
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static const uint64_t L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+Perf_Counters::Perf_Counters() : leader(-1), opened(0) {
+    fds.fill(-1);
+    slot.fill(-1);
+    const std::pair<uint32_t, uint64_t> events[NUM_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, L1D_READ_MISS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    };
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        int fd = open_event(events[e].first, events[e].second, leader);
+        if (fd < 0) {
+            if (error.empty()) {
+                error = std::string(name((EVENT)e)) + ": " + std::strerror(errno);
+            }
+            continue;
+        }
+        if (leader < 0) {
+            leader = fd;
+        }
+        fds[e] = fd;
+        slot[e] = opened++;
+    }
+    if (opened) {
+        error.clear();
+    }
+}
+
+Perf_Counters::~Perf_Counters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void Perf_Counters::start() {
+    if (leader < 0) {
+        return;
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+Perf_Counters::counts Perf_Counters::stop() {
+    counts ans{};
+    if (leader < 0) {
+        return ans;
+    }
+    ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // nr, time enabled, time running, then one value per counter
+    uint64_t buf[3 + NUM_EVENTS];
+    if (read(leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t))) {
+        return ans;
+    }
+    double scale = buf[2] ? (double)buf[1] / buf[2] : 1;
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        if (slot[e] >= 0 && (uint64_t)slot[e] < buf[0]) {
+            ans[e] = buf[3 + slot[e]] * scale;
+        }
+    }
+    return ans;
+}
+
+#else
+
+Perf_Counters::Perf_Counters() : leader(-1), opened(0), error("perf_event_open is Linux only") {
+    fds.fill(-1);
+    slot.fill(-1);
+}
+
+Perf_Counters::~Perf_Counters() {}
+
+void Perf_Counters::start() {}
+
+Perf_Counters::counts Perf_Counters::stop() {
+    return counts{};
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include <array>
+#include <cstdint>
+#include <string>
+
+#pragma once
+
+// Hardware performance counters for this thread, through Linux's
+// perf_event_open. Whatever counters the kernel and CPU will give us are
+// opened as one group, so they all count over exactly the same stretch of
+// code. Counters that can't be opened (not Linux, a VM without a PMU, or
+// perf_event_paranoid too strict) are left out, and if none can be opened
+// available() is false and everything else does nothing.
+class Perf_Counters {
+    public:
+        enum EVENT {CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, NUM_EVENTS};
+        typedef std::array<uint64_t, NUM_EVENTS> counts;
+
+    private:
+        std::array<int, NUM_EVENTS> fds;            // -1 where the counter couldn't be opened
+        std::array<int, NUM_EVENTS> slot;           // Where each counter comes in a group read
+        int leader;
+        int opened;
+        std::string error;
+
+    public:
+        Perf_Counters();
+        ~Perf_Counters();
+
+        // Disallow copies, they'd close each other's file descriptors
+        Perf_Counters(const Perf_Counters&) = delete;
+        Perf_Counters& operator=(const Perf_Counters&) = delete;
+
+        bool available() const { return opened > 0; }
+        bool has(const EVENT e) const { return fds[e] >= 0; }
+        // Why nothing could be opened, if it couldn't
+        const std::string &why_unavailable() const { return error; }
+
+        // Zero the counters and start them
+        void start();
+        // Stop them and read them out; counters that aren't open read 0. If the
+        // kernel had to share the hardware with other counters the values are
+        // scaled up to the whole time.
+        counts stop();
+
+        static const char *name(const EVENT e);
+};
@@ -0,0 +1,244 @@
+#include "perft.hh"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Biggest power of two buckets that fits
+Perft_Table::Perft_Table(const size_t megabytes) {
+    uint64_t buckets = 1;
+    while (buckets * 2 * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) {
+        buckets *= 2;
+    }
+    entries = std::make_unique<Entry[]>(2 * buckets);
+    bucket_mask = buckets - 1;
+}
+
+bool Perft_Table::probe(const uint64_t key, const int depth, uint64_t &count) const {
+    const Entry *bucket = &entries[2 * (key & bucket_mask)];
+    for (int i = 0; i < 2; ++i) {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && (int)(data & 0xFF) == depth) {
+            count = data >> 8;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Perft_Table::store(const uint64_t key, const int depth, const uint64_t count) {
+    Entry *bucket = &entries[2 * (key & bucket_mask)];
+    uint64_t data = (count << 8) | depth;
+    // Take the deep slot if this count cost at least as much as the one there
+    Entry &slot = (int)(bucket[0].data.load(std::memory_order_relaxed) & 0xFF) <= depth ? bucket[0] : bucket[1];
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+// The last ply is counted straight off the move list, without playing it.
+// Counts of one ply are cheaper to redo than to look up, so aren't saved.
+uint64_t perft(Board &board, const int depth, Perft_Table *table) {
+    if (depth == 0) {
+        return 1;
+    }
+    uint64_t nodes = 0;
+    if (table && depth > 1 && table->probe(board.hash(), depth, nodes)) {
+        return nodes;
+    }
+    MoveList moves;
+    board.get_legal_moves(board.is_white_turn(), moves);
+    if (depth == 1) {
+        return moves.size();
+    }
+    for (const PackedMove &m : moves) {
+        UndoInfo undo = board.make_move(m);
+        nodes += perft(board, depth - 1, table);
+        board.unmake_move(m, undo);
+    }
+    if (table) {
+        table->store(board.hash(), depth, nodes);
+    }
+    return nodes;
+}
+
+std::vector<std::pair<PackedMove, uint64_t>> perft_divide(Board &board, const int depth, Perft_Table *table) {
+    std::vector<std::pair<PackedMove, uint64_t>> ans;
+    MoveList moves;
+    board.get_legal_moves(board.is_white_turn(), moves);
+    for (const PackedMove &m : moves) {
+        UndoInfo undo = board.make_move(m);
+        ans.push_back({m, perft(board, depth - 1, table)});
+        board.unmake_move(m, undo);
+    }
+    return ans;
+}
+
+// One subtree to count: the moves that lead to it from the root
+struct Perft_Job {
+    std::vector<PackedMove> line;
+    uint root;                      // Which root move the line starts with
+};
+
+// Every line $depth plies long (or shorter, if the game ends first there
+// is nothing to count and it is left out)
+static void collect_jobs(Board &board, const int depth, std::vector<PackedMove> &line, const uint root,
+                         std::vector<Perft_Job> &jobs) {
+    if (depth == 0) {
+        jobs.push_back({line, root});
+        return;
+    }
+    MoveList moves;
+    board.get_legal_moves(board.is_white_turn(), moves);
+    for (const PackedMove &m : moves) {
+        UndoInfo undo = board.make_move(m);
+        line.push_back(m);
+        collect_jobs(board, depth - 1, line, root, jobs);
+        line.pop_back();
+        board.unmake_move(m, undo);
+    }
+}
+
+// Job numbers, dealt out to one queue per thread. A thread takes from the back
+// of its own queue and steals from the front of the others'.
+class Job_Queues {
+    private:
+        std::vector<std::deque<size_t>> queues;
+        std::vector<std::mutex> locks;
+    public:
+        Job_Queues(const size_t jobs, const uint threads) : queues(threads), locks(threads) {
+            for (size_t i = 0; i < jobs; ++i) {
+                queues[i % threads].push_back(i);
+            }
+        }
+
+        // False once every queue is empty
+        bool next(const uint me, size_t &job) {
+            for (uint i = 0; i < queues.size(); ++i) {
+                uint victim = (me + i) % queues.size();
+                std::lock_guard<std::mutex> hold(locks[victim]);
+                if (queues[victim].empty()) {
+                    continue;
+                }
+                if (victim == me) {
+                    job = queues[victim].back();
+                    queues[victim].pop_back();
+                } else {
+                    job = queues[victim].front();
+                    queues[victim].pop_front();
+                }
+                return true;
+            }
+            return false;
+        }
+};
+
+std::vector<std::pair<PackedMove, uint64_t>> parallel_perft_divide(const Board &board, const int depth,
+                                                                   const int threads, const int split_depth,
+                                                                   Perft_Table *table) {
+    std::vector<std::pair<PackedMove, uint64_t>> ans;
+    if (depth < 1) {
+        return ans;
+    }
+    int split = std::max(1, std::min(split_depth, depth));
+    std::unique_ptr<Board> root = board.clone();
+    MoveList moves;
+    root->get_legal_moves(root->is_white_turn(), moves);
+    std::vector<Perft_Job> jobs;
+    std::vector<PackedMove> line;
+    for (uint i = 0; i < moves.size(); ++i) {
+        ans.push_back({moves[i], 0});
+        UndoInfo undo = root->make_move(moves[i]);
+        line.assign(1, moves[i]);
+        collect_jobs(*root, split - 1, line, i, jobs);
+        root->unmake_move(moves[i], undo);
+    }
+
+    // Each job's count goes in its own slot, so the threads never share a write
+    std::vector<uint64_t> counts(jobs.size());
+    uint workers = std::max(1, threads);
+    Job_Queues queues(jobs.size(), workers);
+    auto work = [&](const uint me) {
+        std::unique_ptr<Board> mine = root->clone();
+        std::vector<UndoInfo> undos;
+        size_t job;
+        while (queues.next(me, job)) {
+            const std::vector<PackedMove> &path = jobs[job].line;
+            for (const PackedMove &m : path) {
+                undos.push_back(mine->make_move(m));
+            }
+            counts[job] = perft(*mine, depth - path.size(), table);
+            for (auto m = path.rbegin(); m != path.rend(); ++m) {
+                mine->unmake_move(*m, undos.back());
+                undos.pop_back();
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint i = 1; i < workers; ++i) {
+        pool.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        ans[jobs[i].root].second += counts[i];
+    }
+    return ans;
+}
+
+uint64_t parallel_perft(const Board &board, const int depth, const int threads, const int split_depth,
+                        Perft_Table *table) {
+    if (depth == 0) {
+        return 1;
+    }
+    uint64_t nodes = 0;
+    for (const auto &entry : parallel_perft_divide(board, depth, threads, split_depth, table)) {
+        nodes += entry.second;
+    }
+    return nodes;
+}
+
+const std::vector<Perft_Position> PERFT_SUITE = {
+    {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        {48, 2039, 97862, 4085603, 193690690}},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        {6, 264, 9467, 422333, 15833292}},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        {44, 1486, 62379, 2103487, 89941194}},
+    {"illegal en passant", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+        {18, 92, 1670, 10138, 185429, 1134888}},
+    {"en passant gives check", "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+        {13, 102, 1266, 10276, 135655, 1015133}},
+    {"en passant out of check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+        {15, 126, 1928, 13931, 206379, 1440467}},
+    {"short castle gives check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+        {15, 66, 1198, 6399, 120330, 661072}},
+    {"long castle gives check", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+        {16, 71, 1286, 7418, 141077, 803711}},
+    {"castling rights", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",
+        {26, 1141, 27826, 1274206}},
+    {"castling prevented", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1",
+        {44, 1494, 50509, 1720476}},
+    {"promote out of check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
+        {11, 133, 1442, 19174, 266199, 3821001}},
+    {"discovered check", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+        {29, 165, 5160, 31961, 1004658}},
+    {"promote to give check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1",
+        {9, 40, 472, 2661, 38983, 217342}},
+    {"underpromote to give check", "8/P1k5/K7/8/8/8/8/8 w - - 0 1",
+        {6, 27, 273, 1329, 18135, 92683}},
+    {"self stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1",
+        {2, 6, 13, 63, 382, 2217}},
+    {"stalemate and checkmate", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1",
+        {10, 25, 268, 926, 10857, 43261, 567584}},
+    {"double check", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
+        {37, 183, 6559, 23527}},
+};
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+#pragma once
+
+#include "Board.hh"
+
+// Perft: count every line of legal moves to a fixed depth. The counts for
+// well known positions are published, so this checks the move generator, and
+// how fast it goes is a fair measure of how fast the generator is.
+
+// Counts already worked out, by Zobrist key and depth, so a position reached
+// by several move orders is only counted once. Threads share one table with
+// no locks: an entry is two words, the count (with the depth in its low byte)
+// and the key XORed with it. A reader that sees half of one write and half of
+// another gets a key that doesn't check out and treats it as a miss, so a
+// race can cost a recount but never give a wrong answer.
+class Perft_Table {
+    private:
+        struct Entry {
+            std::atomic<uint64_t> check;    // key ^ data
+            std::atomic<uint64_t> data;     // count << 8 | depth
+        };
+        // Two entries a bucket: one kept for the deepest count seen, one
+        // for whatever came last
+        std::unique_ptr<Entry[]> entries;
+        uint64_t bucket_mask;
+    public:
+        Perft_Table(const size_t megabytes);
+
+        // Disallow copies, it's big and it's shared
+        Perft_Table(const Perft_Table&) = delete;
+        Perft_Table& operator=(const Perft_Table&) = delete;
+
+        bool probe(const uint64_t key, const int depth, uint64_t &count) const;
+        void store(const uint64_t key, const int depth, const uint64_t count);
+};
+
+// Number of move sequences $depth plies long from the current position,
+// looking up and saving subtree counts in $table if one is given
+uint64_t perft(Board &board, const int depth, Perft_Table *table = nullptr);
+
+// Perft split up by the first move, for tracking down which move a wrong
+// count comes from
+std::vector<std::pair<PackedMove, uint64_t>> perft_divide(Board &board, const int depth,
+                                                          Perft_Table *table = nullptr);
+
+// The same, spread over $threads threads. Every line $split_depth plies
+// long from the current position is one job. Each thread works through its
+// own share of the jobs on its own clone of the board, then takes jobs from
+// the others' shares once it runs out. Counts are added up in job order, so
+// the answer doesn't depend on which thread did what.
+uint64_t parallel_perft(const Board &board, const int depth, const int threads, const int split_depth = 2,
+                        Perft_Table *table = nullptr);
+std::vector<std::pair<PackedMove, uint64_t>> parallel_perft_divide(const Board &board, const int depth,
+                                                                   const int threads, const int split_depth = 2,
+                                                                   Perft_Table *table = nullptr);
+
+struct Perft_Position {
+    std::string name;
+    std::string fen;
+    std::vector<uint64_t> counts;   // counts[d - 1] is perft(d)
+};
+
+// Reference positions and their published counts: the start position,
+// Kiwipete, and positions picked for en passant, castling and promotion
+// edge cases
+extern const std::vector<Perft_Position> PERFT_SUITE;
@@ -0,0 +1,141 @@
+#include "Board.hh"
+#include "perft.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// perft [options] <depth> [fen]      counts from one position (the start if
+//                                    no FEN), split by the first move
+// perft [options] suite [max depth]  checks every reference position against
+//                                    its published counts, up to max depth
+//                                    (default 5)
+// options:
+//   -t <threads>   threads to count with, default all cores
+//   -s <plies>     how deep to split the tree into jobs for the threads, default 2
+//   -H <MB>        size of a table of subtree counts shared by the threads,
+//                  default none
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Options {
+    int threads;
+    int split_depth;
+    int hash_mb;
+};
+
+void print_usage() {
+    std::printf("usage: perft [-t threads] [-s split depth] [-H hash MB] <depth> [fen]\n"
+                "       perft [-t threads] [-s split depth] [-H hash MB] suite [max depth]\n");
+}
+
+// A fresh table every time, so one position's counts can't vouch for another's
+std::unique_ptr<Perft_Table> make_table(const Options &opts) {
+    return opts.hash_mb ? std::make_unique<Perft_Table>(opts.hash_mb) : nullptr;
+}
+
+uint64_t count(Board &board, const int depth, const Options &opts) {
+    std::unique_ptr<Perft_Table> table = make_table(opts);
+    if (opts.threads > 1) {
+        return parallel_perft(board, depth, opts.threads, opts.split_depth, table.get());
+    }
+    return perft(board, depth, table.get());
+}
+
+int run_divide(const int depth, const std::string &fen, const Options &opts) {
+    Board board;
+    if (!fen.empty() && !board.set_fen(fen)) {
+        std::printf("can't read FEN \"%s\"\n", fen.c_str());
+        return 1;
+    }
+    std::printf("%s\n", board.fen().c_str());
+    Clock::time_point start = Clock::now();
+    uint64_t total = 0;
+    std::unique_ptr<Perft_Table> table = make_table(opts);
+    auto divide = opts.threads > 1 ? parallel_perft_divide(board, depth, opts.threads, opts.split_depth, table.get())
+                                   : perft_divide(board, depth, table.get());
+    for (const auto &entry : divide) {
+        Move m = board.to_move(entry.first);
+        std::printf("%s%s: %llu\n", m.start.c_str(), m.end.c_str(), (unsigned long long)entry.second);
+        total += entry.second;
+    }
+    double elapsed = seconds_since(start);
+    std::printf("\nnodes: %llu\ntime:  %.3f s\nnps:   %.0f\n",
+                (unsigned long long)total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+    return 0;
+}
+
+int run_suite(const int max_depth, const Options &opts) {
+    int failures = 0;
+    uint64_t total = 0;
+    Clock::time_point suite_start = Clock::now();
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        Board board;
+        board.set_fen(pos.fen);
+        int depth = std::min<int>(max_depth, pos.counts.size());
+        Clock::time_point start = Clock::now();
+        uint64_t nodes = count(board, depth, opts);
+        double elapsed = seconds_since(start);
+        bool ok = nodes == pos.counts[depth - 1];
+        failures += !ok;
+        total += nodes;
+        std::printf("%-28s depth %d %12llu %s", pos.name.c_str(), depth, (unsigned long long)nodes, ok ? "ok  " : "FAIL");
+        if (!ok) {
+            std::printf(" (expected %llu)", (unsigned long long)pos.counts[depth - 1]);
+        }
+        std::printf(" %8.3f s\n", elapsed);
+    }
+    double elapsed = seconds_since(suite_start);
+    std::printf("\n%d of %zu positions wrong, %llu nodes in %.3f s, %.0f nps\n", failures, PERFT_SUITE.size(),
+                (unsigned long long)total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    Options opts{std::max(1, (int)std::thread::hardware_concurrency()), 2, 0};
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "-s" || arg == "-H") && i + 1 < argc) {
+            int value = std::atoi(argv[++i]);
+            if (value < 1) {
+                print_usage();
+                return 1;
+            }
+            (arg == "-t" ? opts.threads : arg == "-s" ? opts.split_depth : opts.hash_mb) = value;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        print_usage();
+        return 1;
+    }
+    if (args[0] == "suite") {
+        int max_depth = args.size() > 1 ? std::atoi(args[1].c_str()) : 5;
+        if (max_depth < 1) {
+            print_usage();
+            return 1;
+        }
+        return run_suite(max_depth, opts);
+    }
+    int depth = std::atoi(args[0].c_str());
+    if (depth < 1) {
+        print_usage();
+        return 1;
+    }
+    // The FEN's fields may come in as separate arguments if it wasn't quoted
+    std::string fen;
+    for (size_t i = 1; i < args.size(); ++i) {
+        fen += (i > 1 ? " " : "") + args[i];
+    }
+    return run_divide(depth, fen, opts);
+}
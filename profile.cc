@@ -0,0 +1,121 @@
+#include "profile.hh"
+
+#include <cstdio>
+#include <cstdlib>
+
+const char *profile_point_name(const PROFILE_POINT p) {
+    static const char *names[NUM_PROFILE_POINTS] = {
+        "legal_moves", "make_move", "unmake_move", "castleing", "execute_move", "threefold_rep",
+        "evaluate"
+    };
+    return names[p];
+}
+
+std::string profile_report() {
+    Profile_Stats stats = profile_stats();
+    std::string ans;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-16s %14s %16s %12s\n", "profile", "calls", "cycles", "cycles/call");
+    ans += line;
+    for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+        std::snprintf(line, sizeof(line), "%-16s %14llu %16llu %12.1f\n", profile_point_name((PROFILE_POINT)p),
+                      (unsigned long long)stats.calls[p], (unsigned long long)stats.cycles[p],
+                      stats.calls[p] ? (double)stats.cycles[p] / stats.calls[p] : 0.0);
+        ans += line;
+    }
+    return ans;
+}
+
+#ifdef CHESS_PROFILE
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+// Never destroyed, so threads that finish during shutdown still have
+// somewhere to hand their counts to
+struct Profile_Registry {
+    std::mutex lock;
+    std::vector<Profile_Counters*> live;
+    Profile_Stats retired{};        // Counts from threads that have finished
+};
+
+static Profile_Registry &registry() {
+    static Profile_Registry *r = new Profile_Registry();
+    return *r;
+}
+
+thread_local Profile_Counters PROFILE_COUNTERS;
+
+Profile_Counters::Profile_Counters() {
+    for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+        calls[p] = 0;
+        cycles[p] = 0;
+    }
+    std::lock_guard<std::mutex> hold(registry().lock);
+    registry().live.push_back(this);
+}
+
+Profile_Counters::~Profile_Counters() {
+    Profile_Registry &r = registry();
+    std::lock_guard<std::mutex> hold(r.lock);
+    for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+        r.retired.calls[p] += calls[p].load(std::memory_order_relaxed);
+        r.retired.cycles[p] += cycles[p].load(std::memory_order_relaxed);
+    }
+    r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+}
+
+Profile_Stats profile_stats() {
+    Profile_Registry &r = registry();
+    std::lock_guard<std::mutex> hold(r.lock);
+    Profile_Stats ans = r.retired;
+    for (const Profile_Counters *c : r.live) {
+        for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+            ans.calls[p] += c->calls[p].load(std::memory_order_relaxed);
+            ans.cycles[p] += c->cycles[p].load(std::memory_order_relaxed);
+        }
+    }
+    return ans;
+}
+
+// Another thread could be counting at the same moment, so a reset can lose
+// that one call; good enough for zeroing between runs
+void reset_profile_stats() {
+    Profile_Registry &r = registry();
+    std::lock_guard<std::mutex> hold(r.lock);
+    r.retired = Profile_Stats{};
+    for (Profile_Counters *c : r.live) {
+        for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+            c->calls[p].store(0, std::memory_order_relaxed);
+            c->cycles[p].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Thread locals are gone by the time atexit handlers run, so the main
+// thread's counts are in retired by then
+static void dump_at_exit() {
+    const char *where = std::getenv("CHESS_PROFILE_DUMP");
+    std::string report = profile_report();
+    FILE *out = std::string(where) == "1" ? stderr : std::fopen(where, "w");
+    if (!out) {
+        out = stderr;
+    }
+    std::fputs(report.c_str(), out);
+    if (out != stderr) {
+        std::fclose(out);
+    }
+}
+
+static const bool DUMP_REGISTERED = std::getenv("CHESS_PROFILE_DUMP") && std::atexit(dump_at_exit) == 0;
+
+#else
+
+Profile_Stats profile_stats() {
+    return Profile_Stats{};
+}
+
+void reset_profile_stats() {}
+
+#endif
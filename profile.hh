@@ -0,0 +1,82 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#pragma once
+
+// Call and cycle counts for the hot spots in Board and the engines. Build with
+// -DCHESS_PROFILE to turn them on; without it PROFILE_SCOPE expands to
+// nothing and the stats all read zero, so production builds pay nothing.
+//
+// Each thread counts into its own counters, so counting never contends; the
+// stats calls add every thread's counters up when asked. With CHESS_PROFILE
+// on, setting CHESS_PROFILE_DUMP in the environment prints a report at exit,
+// to stderr, or to the file it names if it isn't "1".
+
+enum PROFILE_POINT {
+    PROFILE_LEGAL_MOVES, PROFILE_MAKE_MOVE, PROFILE_UNMAKE_MOVE, PROFILE_CASTLEING,
+    PROFILE_EXECUTE_MOVE, PROFILE_THREEFOLD_REP, PROFILE_EVALUATE, NUM_PROFILE_POINTS
+};
+
+struct Profile_Stats {
+    std::array<uint64_t, NUM_PROFILE_POINTS> calls;
+    std::array<uint64_t, NUM_PROFILE_POINTS> cycles;   // rdtsc ticks (ns off x86), inclusive
+};
+
+// Everything counted so far, by every thread
+Profile_Stats profile_stats();
+void reset_profile_stats();
+// A table of calls, cycles and cycles per call for each point
+std::string profile_report();
+const char *profile_point_name(const PROFILE_POINT p);
+
+#ifdef CHESS_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint64_t profile_clock() { return __rdtsc(); }
+#else
+#include <chrono>
+inline uint64_t profile_clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+// One thread's counters. Only the owning thread writes them; the atomics
+// (relaxed, so plain loads and stores) are so the stats calls can read them.
+struct Profile_Counters {
+    std::array<std::atomic<uint64_t>, NUM_PROFILE_POINTS> calls;
+    std::array<std::atomic<uint64_t>, NUM_PROFILE_POINTS> cycles;
+
+    Profile_Counters();     // Signs up with the stats
+    ~Profile_Counters();    // Hands its counts over before the thread goes
+
+    void add(const PROFILE_POINT p, const uint64_t ticks) {
+        calls[p].store(calls[p].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        cycles[p].store(cycles[p].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+    }
+};
+
+extern thread_local Profile_Counters PROFILE_COUNTERS;
+
+// Counts from construction to the end of the enclosing block
+class Profile_Scope {
+    private:
+        PROFILE_POINT point;
+        uint64_t start;
+    public:
+        Profile_Scope(const PROFILE_POINT p) : point(p), start(profile_clock()) {}
+        ~Profile_Scope() { PROFILE_COUNTERS.add(point, profile_clock() - start); }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(point) Profile_Scope PROFILE_CONCAT(profile_scope_, __LINE__)(point)
+
+#else
+
+#define PROFILE_SCOPE(point) ((void)0)
+
+#endif
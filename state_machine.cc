@@ -1,17 +1,16 @@
 
 #include "state_machine.hh"
 
+#include <algorithm>
+#include <cassert>
+
 State_Machine::State_Machine(eval_fn e, bool t) :
-    board(std::make_unique<Board>()), eval(e), past_states(std::vector<board_array>(0)), turn(t)
-{
-    past_states.push_back(board->get_board());
-}
+    board(std::make_unique<Board>()), eval(e), past_moves(), turn(t)
+{}
 
-State_Machine::State_Machine(const board_array &b, eval_fn e=null_eval, bool t) :
-    board(std::make_unique<Board>(b)), eval(e), past_states(std::vector<board_array>(0)), turn(t)
-{
-    past_states.push_back(board->get_board());
-}
+State_Machine::State_Machine(const board_array &b, eval_fn e, bool t) :
+    board(std::make_unique<Board>(b)), eval(e), past_moves(), turn(t)
+{}
 
 State_Machine::~State_Machine()
 {}
@@ -26,6 +25,7 @@ double State_Machine::evaluate(){
         }
         return 0;
     }
+    PROFILE_SCOPE(PROFILE_EVALUATE);
     return eval(*board);
 }
 
@@ -34,28 +34,32 @@ std::vector<Move> State_Machine::get_actions() {
 }
 
 void State_Machine::perform_action(const Move &m){
-    board->play_move(m);
-    past_states.push_back(board->get_board());
+    PackedMove mv = board->to_packed(m);
+#ifndef NDEBUG
+    // assert is a legal move, as play_move does; make_move takes it on trust
+    MoveList legal;
+    board->get_legal_moves(board->is_white_turn(), legal);
+    assert(std::find(legal.begin(), legal.end(), mv) != legal.end());
+#endif
+    past_moves.push_back({mv, board->make_move(mv)});
 }
 
 board_array State_Machine::get_board() {
     return board->get_board();
 }
 
+// Unmake the last move, which puts back castling, en passant and the clocks too
 void State_Machine::undo(){
-    past_states.pop_back();
-    board->set_board(past_states.back());    
+    board->unmake_move(past_moves.back().first, past_moves.back().second);
+    past_moves.pop_back();
 }
 
 void State_Machine::set_state(const board_array &b){
     board->set_board(b);
-    while(past_states.size() > 0){
-        past_states.pop_back();
-    }
-    past_states.push_back(board->get_board());
+    past_moves.clear();
 }
 
 bool State_Machine::is_terminal() {
-    return board->game_over()
+    return board->game_over();
 }
 
@@ -5,7 +5,7 @@ class State_Machine {
     private:
         std::unique_ptr<Board> board;
         eval_fn eval;
-        std::vector<board_array> past_states;
+        std::vector<std::pair<PackedMove, UndoInfo>> past_moves;
         bool turn;
 
     public:
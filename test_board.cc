@@ -1,9 +1,16 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <thread>
 
 #include "Board.hh"
+#include "AlphaBetaEngine.hh"
+#include "perft.hh"
+#include "time_manager.hh"
+#include "transposition.hh"
 
 const board_array START_BOARD = {
     'R','N','B','Q','K','B','N','R',
@@ -172,6 +179,10 @@ TEST_CASE( "checkmate" ) {
 
 TEST_CASE( "reset" ) {
     b->reset();
+    // Castling rights, clocks and the key all go back too
+    Board fresh{};
+    REQUIRE( b->fen() == fresh.fen() );
+    REQUIRE( b->hash() == fresh.hash() );
     REQUIRE( b->get_past_moves().size() == 0 );
     REQUIRE( b->get_board() == START_BOARD );
     REQUIRE( !b->game_over() );
@@ -193,3 +204,720 @@ TEST_CASE( "threefold repetition" ) {
     b->reset();
 }
 
+TEST_CASE( "set board rebuilds the position" ) {
+    Board board{EN_PASSANT};
+    REQUIRE( board.get_board() == EN_PASSANT );
+    REQUIRE( board.get_square("e6") == 'P' );
+    REQUIRE( board.get_square("e2") == ' ' );
+    REQUIRE( board.to_string() == std::string(EN_PASSANT.begin(), EN_PASSANT.end()) );
+    board.set_board(START_BOARD);
+    REQUIRE( board.get_board() == START_BOARD );
+    REQUIRE( board.get_legal_moves(true).size() == 20 );
+
+    // Repetitions are of the set-up position, not whatever was there before
+    board.set_board(E4);
+    for (int i = 0; i < 2; ++i) {
+        REQUIRE( !board.game_over() );
+        board.play_move({"g1","f3"});
+        board.play_move({"g8","f6"});
+        board.play_move({"f3","g1"});
+        board.play_move({"f6","g8"});
+    }
+    REQUIRE( board.game_over() );
+}
+
+TEST_CASE( "packed moves" ) {
+    Board board{};
+    PackedMove e4 = board.to_packed({"e2","e4"});
+    REQUIRE( e4.start() == to_index("e2") );
+    REQUIRE( e4.end() == to_index("e4") );
+    REQUIRE( e4.flag() == PackedMove::DOUBLE_PUSH );
+    MoveList moves;
+    board.get_legal_moves(true, moves);
+    REQUIRE( moves.size() == 20 );
+    REQUIRE( std::find(moves.begin(), moves.end(), e4) != moves.end() );
+    board.play_move(e4);
+    REQUIRE( board.get_board() == E4 );
+    REQUIRE( board.to_move(board.to_packed({"d7","d5"})).end == "d5" );
+    REQUIRE( board.to_packed({"e4","d5"}).flag() == PackedMove::QUIET );
+    PackedMove promo{to_index("e7"), to_index("f8"), PackedMove::PROMO_CAPTURE | PackedMove::PROMO_Q};
+    REQUIRE( promo.is_capture() );
+    REQUIRE( board.to_move(promo).end == "f8=Q" );
+}
+
+TEST_CASE( "make and unmake" ) {
+    Board board{};
+    for (const Move &m : std::vector<Move>{{"e2","e4"}, {"a7","a6"}, {"g1","f3"}, {"a6","a5"},
+                                           {"f1","c4"}, {"a5","a4"}, {"e4","e5"}, {"f7","f5"}}) {
+        board.play_move(m);
+    }
+    // white can castle and take en passant here
+    auto before = board.get_legal_moves(true);
+    REQUIRE( vec_contains(before, {"e1","g1"}) );
+    REQUIRE( vec_contains(before, {"e5","f6"}) );
+    MoveList moves;
+    board.get_legal_moves(true, moves);
+    for (const PackedMove &m : moves) {
+        board_array start = board.get_board();
+        UndoInfo undo = board.make_move(m);
+        REQUIRE( !board.is_white_turn() );
+        board.unmake_move(m, undo);
+        REQUIRE( board.is_white_turn() );
+        REQUIRE( board.get_board() == start );
+        REQUIRE( board.get_legal_moves(true).size() == before.size() );
+    }
+    // Moving the king loses castling, taking it back gives it back
+    std::vector<PackedMove> line;
+    std::vector<UndoInfo> undos;
+    for (const Move &m : std::vector<Move>{{"e1","f1"}, {"h7","h6"}, {"f1","e1"}, {"h6","h5"}}) {
+        line.push_back(board.to_packed(m));
+        undos.push_back(board.make_move(line.back()));
+    }
+    REQUIRE( !vec_contains(board.get_legal_moves(true), {"e1","g1"}) );
+    while (!line.empty()) {
+        board.unmake_move(line.back(), undos.back());
+        line.pop_back();
+        undos.pop_back();
+    }
+    REQUIRE( vec_contains(board.get_legal_moves(true), {"e1","g1"}) );
+    REQUIRE( vec_contains(board.get_legal_moves(true), {"e5","f6"}) );
+    REQUIRE( board.get_past_moves().size() == 8 );
+}
+
+TEST_CASE( "zobrist hash" ) {
+    Board board{};
+    uint64_t start = board.hash();
+    board.play_move({"g1","f3"});
+    REQUIRE( board.hash() != start );
+    board.play_move({"g8","f6"});
+    board.play_move({"f3","g1"});
+    uint64_t black_to_move = board.hash();
+    board.play_move({"f6","g8"});
+    REQUIRE( board.hash() == start );
+    REQUIRE( black_to_move != start );
+    // Same position reached in a different order hashes the same
+    Board other{};
+    for (const Move &m : std::vector<Move>{{"e2","e4"}, {"e7","e5"}, {"g1","f3"}, {"b8","c6"}}) {
+        board.play_move(m);
+    }
+    for (const Move &m : std::vector<Move>{{"g1","f3"}, {"b8","c6"}, {"e2","e4"}, {"e7","e5"}}) {
+        other.play_move(m);
+    }
+    REQUIRE( board.hash() == other.hash() );
+    // Losing the right to castle changes the key
+    board.play_move({"f1","e2"});
+    board.play_move({"g8","f6"});
+    other.play_move({"f1","e2"});
+    other.play_move({"g8","f6"});
+    board.play_move({"h1","f1"});
+    other.play_move({"e1","f1"});
+    board.play_move({"f6","g8"});
+    other.play_move({"f6","g8"});
+    board.play_move({"f1","h1"});
+    other.play_move({"f1","e1"});
+    REQUIRE( board.get_board() == other.get_board() );
+    REQUIRE( board.hash() != other.hash() );
+    // make/unmake brings the key back
+    MoveList moves;
+    board.get_legal_moves(false, moves);
+    uint64_t before = board.hash();
+    for (const PackedMove &m : moves) {
+        UndoInfo undo = board.make_move(m);
+        board.unmake_move(m, undo);
+        REQUIRE( board.hash() == before );
+    }
+}
+
+TEST_CASE( "fifty move rule" ) {
+    const board_array ROOKS = {
+        'R',' ',' ',' ','K',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ','k',' ',' ','r'
+    };
+    Board board{ROOKS};
+    // Walk the rooks up and down their files. The cycles are 7 and 6 long, so
+    // no position comes round a third time before the fifty moves are up.
+    const std::string white_ranks = "1234567";
+    const std::string black_ranks = "876543";
+    for (int i = 0; i < 50; ++i) {
+        REQUIRE( !board.game_over() );
+        board.play_move({{'a', white_ranks[i % 7]}, {'a', white_ranks[(i + 1) % 7]}});
+        REQUIRE( !board.game_over() );
+        board.play_move({{'h', black_ranks[i % 6]}, {'h', black_ranks[(i + 1) % 6]}});
+    }
+    REQUIRE( board.halfmove_clock() == 100 );
+    REQUIRE( board.game_over() );
+    REQUIRE( !board.white_wins() );
+    REQUIRE( !board.black_wins() );
+    // Setting up a new position starts the count again
+    board.set_board(E4);
+    REQUIRE( board.halfmove_clock() == 0 );
+}
+
+
+TEST_CASE( "attacked squares" ) {
+    Board board;
+    // Pawns attack the squares in front of them diagonally, empty or not
+    REQUIRE( board.is_square_attacked("e3", true) );
+    REQUIRE( board.is_square_attacked("f3", true) );
+    REQUIRE( !board.is_square_attacked("e4", true) );
+    REQUIRE( !board.is_square_attacked("e3", false) );
+    REQUIRE( board.is_square_attacked(45, false) );     // f6
+    // Pieces in the way block sliders
+    REQUIRE( !board.is_square_attacked("a3", false) );
+    board.set_board(E4);
+    REQUIRE( board.is_square_attacked("a6", true) );
+    REQUIRE( board.is_square_attacked("h5", true) );
+    REQUIRE( !board.is_square_attacked("d3", false) );
+
+    // A pawn on g2 covers f1, so white can't castle short, but long is fine
+    const board_array PAWN_ON_G2 = {
+        'R',' ',' ',' ','K',' ',' ','R',
+        ' ',' ',' ',' ',' ',' ','p',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ','k',' ',' ',' '
+    };
+    board.set_board(PAWN_ON_G2);
+    REQUIRE( board.is_square_attacked("f1", false) );
+    REQUIRE( !vec_contains(board.get_legal_moves(true), {"e1","g1"}) );
+    REQUIRE( vec_contains(board.get_legal_moves(true), {"e1","c1"}) );
+}
+
+TEST_CASE( "magic numbers" ) {
+    // Checked by the magic whichever index is in use, so a bad magic can't
+    // hide behind pext
+    REQUIRE( Board::check_magics() );
+}
+
+TEST_CASE( "pins and evasions" ) {
+    // The bishop on e2 is pinned by the rook on e8 and can't move at all
+    const board_array PINNED = {
+        ' ',' ',' ',' ','K',' ',' ',' ',
+        ' ',' ',' ',' ','B',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ','r',' ',' ','k'
+    };
+    Board board{PINNED};
+    for (const Move &m : board.get_legal_moves(true)) {
+        REQUIRE( m.start != "e2" );
+    }
+    REQUIRE( board.get_legal_moves(true).size() == 4 );
+
+    // In check, the only moves are the king's and blocking with the rook
+    const board_array IN_CHECK = {
+        ' ',' ',' ',' ','K',' ',' ',' ',
+        'R',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ','r',' ',' ','k'
+    };
+    board.set_board(IN_CHECK);
+    REQUIRE( board.get_legal_moves(true).size() == 5 );
+    REQUIRE( vec_contains(board.get_legal_moves(true), {"a2","e2"}) );
+    REQUIRE( !vec_contains(board.get_legal_moves(true), {"a2","a3"}) );
+
+    // Taking en passant would take both pawns off the fifth rank and leave
+    // the king open to the rook
+    const board_array EP_PIN = {
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ','P',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        'K','P',' ',' ',' ',' ',' ','r',
+        ' ',' ',' ',' ',' ',' ',' ',' ',
+        ' ',' ','p',' ',' ',' ',' ',' ',
+        ' ',' ',' ',' ',' ',' ',' ','k'
+    };
+    board.set_board(EP_PIN);
+    board.play_move({"h2","h3"});
+    board.play_move({"c7","c5"});
+    REQUIRE( !vec_contains(board.get_legal_moves(true), {"b5","c6"}) );
+    REQUIRE( vec_contains(board.get_legal_moves(true), {"b5","b6"}) );
+}
+
+TEST_CASE( "fen" ) {
+    Board board;
+    REQUIRE( board.fen() == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" );
+    board.play_move({"e2","e4"});
+    REQUIRE( board.fen() == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1" );
+    board.play_move({"g8","f6"});
+    REQUIRE( board.fen() == "rnbqkb1r/pppppppp/5n2/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 1 2" );
+
+    const std::string kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    REQUIRE( board.set_fen(kiwipete) );
+    REQUIRE( board.fen() == kiwipete );
+    REQUIRE( board.get_past_moves().empty() );
+    REQUIRE( board.get_square("e7") == 'q' );
+    // Setting up the same position by hand hashes the same
+    Board by_hand;
+    by_hand.set_board(board.get_board());
+    REQUIRE( by_hand.hash() == board.hash() );
+
+    REQUIRE( board.set_fen("4k3/8/8/8/8/8/8/4K3 b - - 12 40") );
+    REQUIRE( !board.is_white_turn() );
+    REQUIRE( board.halfmove_clock() == 12 );
+    REQUIRE( board.fen() == "4k3/8/8/8/8/8/8/4K3 b - - 12 40" );
+
+    // Nonsense is turned away without touching the board
+    REQUIRE( !board.set_fen("4k3/8/8/8/8/8/8/4K3 x - - 0 1") );
+    REQUIRE( !board.set_fen("4k3/8/8/8/8/8/4K3 w - - 0 1") );
+    REQUIRE( !board.set_fen("4k3/9/8/8/8/8/8/4K3 w - - 0 1") );
+    REQUIRE( board.fen() == "4k3/8/8/8/8/8/8/4K3 b - - 12 40" );
+}
+
+TEST_CASE( "san" ) {
+    Board board;
+    REQUIRE( board.san(board.parse_san("Nf3")) == "Nf3" );
+    REQUIRE( board.parse_san("Nf3") == board.to_packed({"g1","f3"}) );
+    REQUIRE( board.parse_san("e4") == board.to_packed({"e2","e4"}) );
+    REQUIRE( board.parse_san("e2e4") == board.to_packed({"e2","e4"}) );
+    REQUIRE( board.parse_san("e5").is_null() );
+    REQUIRE( board.parse_san("Nd2").is_null() );
+    REQUIRE( board.parse_san("Zf3").is_null() );
+    board.play_move({"f2","f3"});
+    board.play_move({"e7","e5"});
+    board.play_move({"g2","g4"});
+    REQUIRE( board.san(board.parse_san("Qh4")) == "Qh4#" );
+    REQUIRE( board.parse_san("Qh4#!!") == board.to_packed({"d8","h4"}) );
+
+    // Only as much of the start square as it takes to tell the pieces apart
+    REQUIRE( board.set_fen("4k3/8/8/R7/8/8/8/R3K3 w - - 0 1") );
+    REQUIRE( board.san(board.to_packed({"a1","a3"})) == "R1a3" );
+    REQUIRE( board.parse_san("Ra3").is_null() );
+    REQUIRE( board.parse_san("R5a3") == board.to_packed({"a5","a3"}) );
+    REQUIRE( board.set_fen("4k3/8/8/8/8/Q7/8/Q1Q1K3 w - - 0 1") );
+    REQUIRE( board.san(board.to_packed({"a1","b2"})) == "Qa1b2" );
+    REQUIRE( board.san(board.to_packed({"c1","b2"})) == "Qcb2" );
+    REQUIRE( board.parse_san("Qa1xb2") == board.to_packed({"a1","b2"}) );
+
+    REQUIRE( board.set_fen("3k4/1P6/8/3pP3/8/8/8/R3K2R w KQ d6 0 1") );
+    REQUIRE( board.san(board.to_packed({"e5","d6"})) == "exd6" );
+    REQUIRE( board.san(board.to_packed({"b7","b8=Q"})) == "b8=Q+" );
+    REQUIRE( board.parse_san("b8N") == board.to_packed({"b7","b8=N"}) );
+    REQUIRE( board.parse_san("b8").is_null() );
+    REQUIRE( board.parse_san("0-0-0") == board.to_packed({"e1","c1"}) );
+    REQUIRE( board.san(board.parse_san("e1g1")) == "O-O" );
+
+    // Every legal move reads back as itself
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        REQUIRE( board.set_fen(pos.fen) );
+        MoveList moves;
+        board.get_legal_moves(board.is_white_turn(), moves);
+        for (const PackedMove &m : moves) {
+            INFO( pos.name << " " << board.san(m) );
+            REQUIRE( board.parse_san(board.san(m)) == m );
+        }
+        REQUIRE( board.fen() == pos.fen );
+    }
+}
+
+TEST_CASE( "perft" ) {
+    // Shallow enough to run with the tests; perft_driver goes deeper
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        Board board;
+        REQUIRE( board.set_fen(pos.fen) );
+        for (int depth = 1; depth <= (int)pos.counts.size() && pos.counts[depth - 1] < 100000; ++depth) {
+            INFO( pos.name << " depth " << depth );
+            REQUIRE( perft(board, depth) == pos.counts[depth - 1] );
+        }
+        REQUIRE( board.fen() == pos.fen );
+    }
+    Board board;
+    uint64_t total = 0;
+    for (const auto &entry : perft_divide(board, 3)) {
+        total += entry.second;
+    }
+    REQUIRE( total == 8902 );
+}
+
+TEST_CASE( "parallel perft" ) {
+    Board board;
+    REQUIRE( board.set_fen(PERFT_SUITE[1].fen) );
+    // A clone is the same position, and moving on it leaves the original be
+    auto copy = board.clone();
+    REQUIRE( copy->fen() == board.fen() );
+    REQUIRE( copy->hash() == board.hash() );
+    copy->play_move({"e1","g1"});
+    REQUIRE( copy->fen() != board.fen() );
+
+    REQUIRE( parallel_perft(board, 3, 4) == PERFT_SUITE[1].counts[2] );
+    REQUIRE( parallel_perft(board, 3, 3, 1) == PERFT_SUITE[1].counts[2] );
+    auto serial = perft_divide(board, 2);
+    auto parallel = parallel_perft_divide(board, 2, 4, 2);
+    REQUIRE( serial.size() == parallel.size() );
+    for (size_t i = 0; i < serial.size(); ++i) {
+        REQUIRE( serial[i].first == parallel[i].first );
+        REQUIRE( serial[i].second == parallel[i].second );
+    }
+}
+
+TEST_CASE( "hashed perft" ) {
+    // A table small enough to fill up and have entries thrown out
+    Perft_Table table(1);
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        Board board;
+        REQUIRE( board.set_fen(pos.fen) );
+        int depth = std::min<int>(4, pos.counts.size());
+        INFO( pos.name );
+        REQUIRE( perft(board, depth, &table) == pos.counts[depth - 1] );
+        REQUIRE( parallel_perft(board, depth, 4, 2, &table) == pos.counts[depth - 1] );
+    }
+}
+
+TEST_CASE( "profile stats" ) {
+    Board::reset_profile_stats();
+    Board board;
+    board.get_legal_moves(true);
+    board.play_move({"e2","e4"});
+    Profile_Stats stats = Board::profile_stats();
+#ifdef CHESS_PROFILE
+    REQUIRE( stats.calls[PROFILE_LEGAL_MOVES] > 0 );
+    REQUIRE( stats.calls[PROFILE_MAKE_MOVE] > 0 );
+    REQUIRE( stats.calls[PROFILE_CASTLEING] > 0 );
+    REQUIRE( stats.calls[PROFILE_EXECUTE_MOVE] > 0 );
+#else
+    // Compiled out, so nothing is counted
+    for (int p = 0; p < NUM_PROFILE_POINTS; ++p) {
+        REQUIRE( stats.calls[p] == 0 );
+    }
+#endif
+}
+
+TEST_CASE( "captures only" ) {
+    std::vector<std::string> fens;
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        fens.push_back(pos.fen);
+    }
+    // In check, and in check with only captures to get out of it
+    fens.push_back("4k3/8/8/8/8/8/3q4/4K3 w - - 0 1");
+    fens.push_back("4k3/8/8/8/1b6/8/3P4/4K2n w - - 0 1");
+    for (const std::string &fen : fens) {
+        Board board;
+        REQUIRE( board.set_fen(fen) );
+        MoveList all, captures, expected;
+        board.get_legal_moves(board.is_white_turn(), all);
+        board.get_captures(board.is_white_turn(), captures);
+        for (const PackedMove &m : all) {
+            if (m.is_capture() || m.is_promotion()) {
+                expected.push_back(m);
+            }
+        }
+        INFO( fen );
+        REQUIRE( captures.size() == expected.size() );
+        for (const PackedMove &m : expected) {
+            REQUIRE( std::find(captures.begin(), captures.end(), m) != captures.end() );
+        }
+    }
+}
+
+TEST_CASE( "key after a move" ) {
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        Board board;
+        REQUIRE( board.set_fen(pos.fen) );
+        MoveList moves;
+        board.get_legal_moves(board.is_white_turn(), moves);
+        for (const PackedMove &m : moves) {
+            INFO( pos.name << " " << board.san(m) );
+            uint64_t predicted = board.key_after(m);
+            UndoInfo undo = board.make_move(m);
+            REQUIRE( predicted == board.hash() );
+            board.unmake_move(m, undo);
+        }
+    }
+}
+
+TEST_CASE( "gives check" ) {
+    std::vector<std::string> fens;
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        fens.push_back(pos.fen);
+    }
+    // Discovered by en passant, by castling, and by a promotion
+    fens.push_back("8/8/8/k2pP2R/8/8/8/4K3 w - d6 0 1");
+    fens.push_back("8/8/8/8/8/8/8/R3K2k w Q - 0 1");
+    fens.push_back("3k4/1P6/8/8/8/8/8/4K2B w - - 0 1");
+    // Two plies from each, against making the move and looking
+    std::function<void(Board&, int)> walk = [&](Board &board, int depth) {
+        MoveList moves;
+        board.get_legal_moves(board.is_white_turn(), moves);
+        for (const PackedMove &m : moves) {
+            INFO( board.fen() << " " << board.san(m) );
+            bool predicted = board.gives_check(m);
+            UndoInfo undo = board.make_move(m);
+            REQUIRE( predicted == board.in_check() );
+            if (depth > 1) {
+                walk(board, depth - 1);
+            }
+            board.unmake_move(m, undo);
+        }
+    };
+    for (const std::string &fen : fens) {
+        Board board;
+        REQUIRE( board.set_fen(fen) );
+        walk(board, 2);
+    }
+}
+
+TEST_CASE( "static exchange evaluation" ) {
+    struct Exchange {
+        std::string fen;
+        std::string san;
+        int see;
+    };
+    std::vector<Exchange> exchanges = {
+        {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "Rxe5", 100},
+        // Queen lined up behind the bishop, queen behind the rook
+        {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "Nxe5", -220},
+        {"4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "Rxd5", 100},
+        {"3rk3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "Rxd5", -400},
+        // The king can only take back if nothing takes it in turn
+        {"8/8/4k3/3p4/8/8/3Q4/4K3 w - - 0 1", "Qxd5+", -800},
+        {"8/8/4k3/3p4/8/8/3Q4/3RK3 w - - 0 1", "Qxd5+", 100},
+        {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "exd6", 100},
+        {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", "exd6", 0},
+        {"8/P7/8/8/8/8/8/k6K w - - 0 1", "a8=Q", 800},
+        {"1r6/P7/8/8/8/8/8/k6K w - - 0 1", "a8=Q", -100},
+        {"1r6/P7/8/8/8/8/8/k6K w - - 0 1", "axb8=Q", 1300},
+        // Quiet moves count too
+        {"4k3/8/2p5/8/8/8/8/1R2K3 w - - 0 1", "Rb5", -500},
+        {"4k3/8/8/8/8/8/8/4K2R w K - 0 1", "O-O", 0},
+    };
+    for (const Exchange &e : exchanges) {
+        Board board;
+        REQUIRE( board.set_fen(e.fen) );
+        PackedMove m = board.parse_san(e.san);
+        INFO( e.fen << " " << e.san );
+        REQUIRE( !m.is_null() );
+        REQUIRE( board.see(m) == e.see );
+        REQUIRE( board.see_ge(m, e.see) );
+        REQUIRE( !board.see_ge(m, e.see + 1) );
+    }
+
+    // see_ge gets its answer its own way, so check it against see everywhere
+    std::vector<std::string> fens;
+    for (const Perft_Position &pos : PERFT_SUITE) {
+        fens.push_back(pos.fen);
+    }
+    for (const Exchange &e : exchanges) {
+        fens.push_back(e.fen);
+    }
+    for (const std::string &fen : fens) {
+        Board board;
+        REQUIRE( board.set_fen(fen) );
+        MoveList moves;
+        board.get_legal_moves(board.is_white_turn(), moves);
+        for (const PackedMove &m : moves) {
+            int see = board.see(m);
+            INFO( fen << " " << board.san(m) << " see " << see );
+            for (int threshold = -1000; threshold <= 1000; threshold += 50) {
+                REQUIRE( board.see_ge(m, threshold) == (see >= threshold) );
+            }
+            REQUIRE( board.see_ge(m, see) );
+            REQUIRE( !board.see_ge(m, see + 1) );
+        }
+    }
+}
+
+TEST_CASE( "transposition table" ) {
+    Transposition_Table tt(1);
+    Board board;
+    PackedMove e4 = board.parse_san("e4");
+    PackedMove d4 = board.parse_san("d4");
+    uint64_t key = board.hash();
+    TT_Entry hit;
+    REQUIRE( !tt.probe(key, hit) );
+    tt.store(key, e4, -123, 6, BOUND_LOWER);
+    REQUIRE( tt.probe(key, hit) );
+    REQUIRE( hit.move == e4 );
+    REQUIRE( hit.score == -123 );
+    REQUIRE( hit.depth == 6 );
+    REQUIRE( hit.bound == BOUND_LOWER );
+    REQUIRE( !tt.probe(key ^ 1, hit) );
+
+    // A much shallower bound doesn't push out a deeper result, an exact score does
+    tt.store(key, d4, 50, 2, BOUND_UPPER);
+    REQUIRE( tt.probe(key, hit) );
+    REQUIRE( hit.depth == 6 );
+    tt.store(key, PackedMove{}, 50, 2, BOUND_EXACT);
+    REQUIRE( tt.probe(key, hit) );
+    REQUIRE( hit.depth == 2 );
+    REQUIRE( hit.move == e4 );      // No move given, so the old one stays
+    // Once the search is over, anything goes
+    tt.store(key, e4, 0, 9, BOUND_EXACT);
+    tt.new_search();
+    tt.store(key, d4, 10, 1, BOUND_UPPER);
+    REQUIRE( tt.probe(key, hit) );
+    REQUIRE( hit.move == d4 );
+    REQUIRE( tt.hashfull() >= 0 );
+
+    // Keys that share a bucket all fit until it's full, then the shallowest
+    // goes; the bucket index is the low bits, so these all land together
+    tt.clear();
+    for (uint64_t i = 1; i <= 8; ++i) {
+        tt.store(i << 48, e4, 0, (int)i, BOUND_EXACT);
+    }
+    for (uint64_t i = 1; i <= 8; ++i) {
+        REQUIRE( tt.probe(i << 48, hit) );
+    }
+    tt.store(9ULL << 48, e4, 0, 5, BOUND_EXACT);
+    REQUIRE( !tt.probe(1ULL << 48, hit) );
+    REQUIRE( tt.probe(9ULL << 48, hit) );
+
+    // Threads writing over each other never leave a half written entry
+    tt.clear();
+    auto writer = [&](const int seed) {
+        for (uint64_t i = 0; i < 200000; ++i) {
+            uint64_t k = (i * 0x9E3779B97F4A7C15ULL) ^ seed;
+            tt.store(k, PackedMove(k & 63, (k >> 6) & 63), (int)(k >> 20) & 1023, (int)(k >> 40) & 63, BOUND_EXACT);
+        }
+    };
+    std::thread other(writer, 1);
+    writer(2);
+    other.join();
+    int torn = 0;
+    for (int seed = 1; seed <= 2; ++seed) {
+        for (uint64_t i = 0; i < 200000; ++i) {
+            uint64_t k = (i * 0x9E3779B97F4A7C15ULL) ^ seed;
+            if (tt.probe(k, hit) && (hit.move.start() != (k & 63) || hit.score != ((int)(k >> 20) & 1023))) {
+                // A different key with the same top bits in the same bucket
+                // could match; those are rare, torn entries would be everywhere
+                ++torn;
+            }
+        }
+    }
+    REQUIRE( torn < 20 );
+}
+
+TEST_CASE( "alpha-beta" ) {
+    Board board;
+    AlphaBetaEngine white{board, true};
+    AlphaBetaEngine black{board, false};
+    // Leaves the board as it found it
+    PackedMove m = white.get_move(PackedMove{});
+    REQUIRE( board.fen() == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" );
+    REQUIRE( white.nodes() > 0 );
+    MoveList moves;
+    board.get_legal_moves(true, moves);
+    REQUIRE( std::find(moves.begin(), moves.end(), m) != moves.end() );
+
+    board.play_move({"f2","f3"});
+    board.play_move({"e7","e5"});
+    board.play_move({"g2","g4"});
+    REQUIRE( board.san(black.get_move(PackedMove{})) == "Qh4#" );
+
+    REQUIRE( board.set_fen("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1") );
+    REQUIRE( board.san(white.get_move(PackedMove{})) == "Ra8#" );
+    REQUIRE( board.set_fen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1") );
+    REQUIRE( board.san(white.get_move(PackedMove{})) == "Rxd5" );
+    REQUIRE( white.evaluate() < 0 );
+    REQUIRE( black.evaluate() > 0 );
+
+    // Reports each depth it finishes, and stops on the node budget
+    std::vector<Search_Info> infos;
+    white.set_info_callback([&](const Search_Info &info) { infos.push_back(info); });
+    Search_Limits limits{};
+    limits.depth = 3;
+    white.set_limits(limits);
+    white.get_move(PackedMove{});
+    REQUIRE( infos.size() == 3 );
+    REQUIRE( infos.back().depth == 3 );
+    REQUIRE( infos.back().best == board.parse_san("Rxd5") );
+    limits = Search_Limits{};
+    limits.nodes = 5000;
+    white.set_limits(limits);
+    REQUIRE( !white.get_move(PackedMove{}).is_null() );
+    REQUIRE( white.nodes() <= 5001 );
+
+    // Nothing to play
+    REQUIRE( board.set_fen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1") );
+    REQUIRE( black.get_move(PackedMove{}).is_null() );
+
+    // The horizon doesn't stop it seeing the recapture
+    REQUIRE( board.set_fen("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1") );
+    limits = Search_Limits{};
+    limits.depth = 1;
+    white.set_limits(limits);
+    REQUIRE( board.san(white.get_move(PackedMove{})) != "Qxd5" );
+    white.set_quiescence_checks(1);
+    REQUIRE( board.san(white.get_move(PackedMove{})) != "Qxd5" );
+}
+
+TEST_CASE( "time manager" ) {
+    Time_Manager tm;
+    Search_Limits limits{};
+    tm.begin(limits);
+    REQUIRE( !tm.is_timed() );
+    REQUIRE( tm.can_start_iteration() );
+    REQUIRE( !tm.must_stop() );
+
+    limits.time_ms = 200;
+    tm.begin(limits);
+    REQUIRE( tm.soft_limit_ms() == 200 );
+    REQUIRE( tm.hard_limit_ms() == 200 );
+
+    // A minute for 30 moves with a second back each time
+    limits = Search_Limits{};
+    limits.clock_ms = 60000;
+    limits.increment_ms = 1000;
+    tm.begin(limits);
+    double soft = tm.soft_limit_ms();
+    REQUIRE( soft > 2000 );
+    REQUIRE( soft < 3000 );
+    REQUIRE( tm.hard_limit_ms() > soft );
+    REQUIRE( tm.hard_limit_ms() <= 30000 );
+    REQUIRE( tm.can_start_iteration() );
+    // Trouble stretches the soft limit, never past the hard one, and calm
+    // shrinks it back
+    tm.iteration_done(true, false);
+    REQUIRE( tm.soft_limit_ms() > soft );
+    for (int i = 0; i < 10; ++i) {
+        tm.iteration_done(true, true);
+    }
+    REQUIRE( tm.soft_limit_ms() <= tm.hard_limit_ms() );
+    for (int i = 0; i < 30; ++i) {
+        tm.iteration_done(false, false);
+    }
+    REQUIRE( tm.soft_limit_ms() == soft );
+
+    // The last move before the time control can use most of what's left
+    limits.moves_to_go = 1;
+    tm.begin(limits);
+    REQUIRE( tm.hard_limit_ms() < limits.clock_ms );
+    REQUIRE( tm.soft_limit_ms() > 30000 );
+
+    // The engine keeps to it, on a fixed time or on a nearly empty clock
+    Board board;
+    AlphaBetaEngine engine{board, true};
+    limits = Search_Limits{};
+    limits.time_ms = 100;
+    engine.set_limits(limits);
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE( !engine.get_move(PackedMove{}).is_null() );
+    REQUIRE( std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000) );
+    limits = Search_Limits{};
+    limits.clock_ms = 150;
+    tm.begin(limits);
+    REQUIRE( tm.hard_limit_ms() < limits.clock_ms );
+    engine.set_limits(limits);
+    start = std::chrono::steady_clock::now();
+    REQUIRE( !engine.get_move(PackedMove{}).is_null() );
+    // Stopped at the hard limit, give or take a loaded machine
+    REQUIRE( std::chrono::steady_clock::now() - start <
+             std::chrono::milliseconds((int)tm.hard_limit_ms() + 1000) );
+    REQUIRE( board.fen() == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" );
+}
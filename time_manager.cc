@@ -0,0 +1,62 @@
+#include "time_manager.hh"
+
+#include <algorithm>
+
+// How far the soft limit can stretch, and how much each worry stretches it
+const double MAX_STRETCH = 3.0;
+const double FAIL_LOW_STRETCH = 1.5;
+const double BEST_CHANGED_STRETCH = 1.3;
+// A calm iteration takes back some of the stretch
+const double CALM_SHRINK = 0.9;
+
+Time_Manager::Time_Manager() : soft_ms(0), hard_ms(0), stretch(1), timed(false) {}
+
+void Time_Manager::begin(const Search_Limits &limits) {
+    start = Clock::now();
+    stretch = 1;
+    timed = true;
+    if (limits.time_ms) {
+        soft_ms = hard_ms = limits.time_ms;
+    } else if (limits.clock_ms) {
+        double left = std::max<double>((double)limits.clock_ms - MOVE_OVERHEAD_MS, 1);
+        int moves_to_go = limits.moves_to_go > 0 ? limits.moves_to_go : DEFAULT_MOVES_TO_GO;
+        // This move's share, then the increment that comes back after it
+        soft_ms = left / moves_to_go + limits.increment_ms * 0.75;
+        // Never more than most of what's left, however few moves there are to go
+        hard_ms = std::min(left * (moves_to_go == 1 ? 0.9 : 0.5), soft_ms * 5);
+        soft_ms = std::min(soft_ms, hard_ms);
+    } else {
+        timed = false;
+        soft_ms = hard_ms = 0;
+    }
+}
+
+double Time_Manager::elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double Time_Manager::soft_limit_ms() const {
+    return std::min(soft_ms * stretch, hard_ms);
+}
+
+bool Time_Manager::can_start_iteration() const {
+    return !timed || elapsed_ms() < soft_limit_ms();
+}
+
+bool Time_Manager::must_stop() const {
+    return timed && elapsed_ms() >= hard_ms;
+}
+
+void Time_Manager::iteration_done(const bool failed_low, const bool best_changed) {
+    if (!failed_low && !best_changed) {
+        stretch = std::max(1.0, stretch * CALM_SHRINK);
+        return;
+    }
+    if (failed_low) {
+        stretch *= FAIL_LOW_STRETCH;
+    }
+    if (best_changed) {
+        stretch *= BEST_CHANGED_STRETCH;
+    }
+    stretch = std::min(stretch, MAX_STRETCH);
+}
@@ -0,0 +1,49 @@
+#include <chrono>
+
+#pragma once
+
+#include "Engine.hh"
+
+// Decides how long a search may take. From a fixed move time it allows
+// exactly that. From a clock it sets two limits: a soft one, past which no
+// new iteration is started, from the share of the remaining time and
+// increment one move should get; and a hard one, at which the search is
+// stopped wherever it is, set so a single move can never lose on time.
+//
+// The soft limit stretches, up to the hard one, while the search looks
+// unsure of itself: when the score drops or the best move keeps changing.
+class Time_Manager {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        Clock::time_point start;
+        double soft_ms;
+        double hard_ms;
+        double stretch;             // Multiplies soft_ms, 1 when the search is calm
+        bool timed;
+    public:
+        // Kept back from every move for the time it takes to get the move to
+        // the board and the clock stopped
+        static constexpr int MOVE_OVERHEAD_MS = 20;
+        // Moves the remaining time is shared over when moves-to-go isn't given
+        static constexpr int DEFAULT_MOVES_TO_GO = 30;
+
+        Time_Manager();
+
+        // Starts the clock on a search with these limits
+        void begin(const Search_Limits &limits);
+        // Does this search have a time limit at all
+        bool is_timed() const { return timed; }
+
+        double elapsed_ms() const;
+        double soft_limit_ms() const;
+        double hard_limit_ms() const { return hard_ms; }
+        // Time for another iteration?
+        bool can_start_iteration() const;
+        // Time to stop, even mid-iteration?
+        bool must_stop() const;
+
+        // After each iteration: did the score fall from the last one, and did
+        // the best move change
+        void iteration_done(const bool failed_low, const bool best_changed);
+};
@@ -0,0 +1,120 @@
+#include "transposition.hh"
+
+#include <algorithm>
+#include <climits>
+
+// Field positions in an entry
+const int MOVE_SHIFT = 16;
+const int SCORE_SHIFT = 32;
+const int DEPTH_SHIFT = 48;
+const int BOUND_SHIFT = 56;
+const int GEN_SHIFT = 58;
+const uint8_t GEN_MASK = 63;
+
+static uint16_t key_bits(const uint64_t key) {
+    return key >> 48;
+}
+
+static uint64_t pack(const uint64_t key, const PackedMove move, const int score, const int depth,
+                     const BOUND bound, const uint8_t generation) {
+    return key_bits(key) | (uint64_t)move.data << MOVE_SHIFT | (uint64_t)(uint16_t)(int16_t)score << SCORE_SHIFT |
+           (uint64_t)std::min(std::max(depth, 0), 255) << DEPTH_SHIFT | (uint64_t)bound << BOUND_SHIFT |
+           (uint64_t)generation << GEN_SHIFT;
+}
+
+static int depth_of(const uint64_t entry) {
+    return (entry >> DEPTH_SHIFT) & 0xFF;
+}
+
+static BOUND bound_of(const uint64_t entry) {
+    return (BOUND)((entry >> BOUND_SHIFT) & 3);
+}
+
+static uint8_t generation_of(const uint64_t entry) {
+    return entry >> GEN_SHIFT;
+}
+
+Transposition_Table::Transposition_Table(const size_t megabytes) : bucket_mask(0), generation(0) {
+    resize(megabytes);
+}
+
+void Transposition_Table::resize(const size_t megabytes) {
+    uint64_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+    buckets = std::make_unique<Bucket[]>(count);
+    bucket_mask = count - 1;
+}
+
+void Transposition_Table::clear() {
+    for (uint64_t b = 0; b <= bucket_mask; ++b) {
+        for (std::atomic<uint64_t> &entry : buckets[b].entries) {
+            entry.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void Transposition_Table::new_search() {
+    generation = (generation + 1) & GEN_MASK;
+}
+
+bool Transposition_Table::probe(const uint64_t key, TT_Entry &ans) const {
+    const Bucket &bucket = buckets[key & bucket_mask];
+    for (const std::atomic<uint64_t> &slot : bucket.entries) {
+        uint64_t entry = slot.load(std::memory_order_relaxed);
+        if (bound_of(entry) != BOUND_NONE && (uint16_t)entry == key_bits(key)) {
+            ans.move.data = entry >> MOVE_SHIFT;
+            ans.score = (int16_t)(entry >> SCORE_SHIFT);
+            ans.depth = depth_of(entry);
+            ans.bound = bound_of(entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Transposition_Table::store(const uint64_t key, const PackedMove move, const int score, const int depth,
+                                const BOUND bound) {
+    Bucket &bucket = buckets[key & bucket_mask];
+    std::atomic<uint64_t> *victim = &bucket.entries[0];
+    int victim_worth = INT_MAX;
+    for (std::atomic<uint64_t> &slot : bucket.entries) {
+        uint64_t entry = slot.load(std::memory_order_relaxed);
+        if (bound_of(entry) != BOUND_NONE && (uint16_t)entry == key_bits(key)) {
+            // A shallower result only replaces a deeper one if it is exact or
+            // the deeper one is left over from an earlier search
+            if (bound != BOUND_EXACT && generation_of(entry) == generation && depth + 2 < depth_of(entry)) {
+                return;
+            }
+            PackedMove best = move;
+            if (best.is_null()) {
+                best.data = entry >> MOVE_SHIFT;
+            }
+            slot.store(pack(key, best, score, depth, bound, generation), std::memory_order_relaxed);
+            return;
+        }
+        // Empty slots go first, then the shallowest; each search of age
+        // counts as much as eight plies of depth
+        int age = (generation - generation_of(entry)) & GEN_MASK;
+        int worth = bound_of(entry) == BOUND_NONE ? INT_MIN : depth_of(entry) - 8 * age;
+        if (worth < victim_worth) {
+            victim = &slot;
+            victim_worth = worth;
+        }
+    }
+    victim->store(pack(key, move, score, depth, bound, generation), std::memory_order_relaxed);
+}
+
+int Transposition_Table::hashfull() const {
+    const uint64_t sample = std::min<uint64_t>(1000 / BUCKET_ENTRIES, bucket_mask + 1);
+    int used = 0;
+    for (uint64_t b = 0; b < sample; ++b) {
+        for (const std::atomic<uint64_t> &slot : buckets[b].entries) {
+            uint64_t entry = slot.load(std::memory_order_relaxed);
+            used += bound_of(entry) != BOUND_NONE && generation_of(entry) == generation;
+        }
+    }
+    return used * 1000 / (sample * BUCKET_ENTRIES);
+}
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#pragma once
+
+#include "Board.hh"
+
+// What a stored score says about the real one: at most it (the search failed
+// low), at least it (it failed high), or exactly it
+enum BOUND {BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT};
+
+struct TT_Entry {
+    PackedMove move;    // Best move found, or the null move
+    int score;
+    int depth;
+    BOUND bound;
+};
+
+// Transposition table for the searches: what was found about each position,
+// so a position reached again by another move order isn't searched again.
+//
+// Each entry is one 64 bit word, so a read or write of one can never be torn
+// and any number of threads can share the table without locks; the worst a
+// race does is lose an entry. From the bottom up an entry holds the top 16
+// bits of the key, the move, the score, the depth, the bound and the
+// generation of the search that stored it. Eight entries make a 64 byte
+// bucket, one cache line, and a key only ever lives in its own bucket.
+class Transposition_Table {
+    private:
+        static constexpr int BUCKET_ENTRIES = 8;
+        struct alignas(64) Bucket {
+            std::atomic<uint64_t> entries[BUCKET_ENTRIES];
+        };
+        std::unique_ptr<Bucket[]> buckets;
+        uint64_t bucket_mask;
+        uint8_t generation;         // Six bits, counts searches; only changed between them
+    public:
+        Transposition_Table(const size_t megabytes);
+
+        // Disallow copies, it's big and it's shared
+        Transposition_Table(const Transposition_Table&) = delete;
+        Transposition_Table& operator=(const Transposition_Table&) = delete;
+
+        // The largest power of two of buckets that fits, and at least one;
+        // throws everything stored away
+        void resize(const size_t megabytes);
+        void clear();
+        // Call once before each search, so entries left from older searches
+        // are the first to go
+        void new_search();
+
+        bool probe(const uint64_t key, TT_Entry &ans) const;
+        // Keeps the deeper of two results for the same position unless the old
+        // one is from an earlier search; otherwise takes the slot in the bucket
+        // whose entry is shallowest and oldest
+        void store(const uint64_t key, const PackedMove move, const int score, const int depth, const BOUND bound);
+
+        // Start loading the key's bucket into cache, ahead of the probe
+        void prefetch(const uint64_t key) const { __builtin_prefetch(&buckets[key & bucket_mask]); }
+
+        // Thousandths of the table filled by the current search, sampled
+        int hashfull() const;
+};
@@ -0,0 +1,43 @@
+#include <cstdint>
+
+#pragma once
+
+// Random keys for Zobrist hashing. A position's key is the XOR of the keys for
+// each piece on its square, the castling rights, the en passant file (only when
+// a capture there is possible) and black_to_move when it is black's turn, so a
+// move can update it with a handful of XORs.
+struct Zobrist_Keys {
+    uint64_t pieces[16][64];    // Indexed by make_piece(colour, type), then square
+    uint64_t castling[16];      // Indexed by the castling rights mask
+    uint64_t ep_file[8];
+    uint64_t black_to_move;
+};
+
+// splitmix64, so the keys are fixed and can be worked out by the compiler
+constexpr uint64_t next_key(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Zobrist_Keys make_zobrist_keys() {
+    Zobrist_Keys keys{};
+    uint64_t state = 0x436865737321ULL;
+    for (int piece = 0; piece < 16; ++piece) {
+        for (int square = 0; square < 64; ++square) {
+            keys.pieces[piece][square] = next_key(state);
+        }
+    }
+    // No rights at all hashes to nothing, so a bare board's key is just its pieces
+    for (int rights = 1; rights < 16; ++rights) {
+        keys.castling[rights] = next_key(state);
+    }
+    for (int file = 0; file < 8; ++file) {
+        keys.ep_file[file] = next_key(state);
+    }
+    keys.black_to_move = next_key(state);
+    return keys;
+}
+
+inline constexpr Zobrist_Keys ZOBRIST = make_zobrist_keys();
\ No newline at end of file